@@ -1481,10 +1481,23 @@ typedef struct Hash {
   int* headz; /*similar to head, but for chainz*/
   unsigned short* chainz; /*those with same amount of zeros*/
   unsigned short* zeros; /*length of zeros streak, used as a second hash chain*/
+
+  size_t* fast; /*4-byte hash to last absolute pos + 1 (0 is empty), only for fastmatch*/
 } Hash;
 
-static unsigned hash_init(Hash* hash, unsigned windowsize) {
+/*the single probe table is small enough to stay in L2 cache*/
+static const unsigned FAST_HASH_BITS = 15;
+
+static unsigned hash_init(Hash* hash, unsigned windowsize, unsigned fastmatch) {
   unsigned i;
+  lodepng_memset(hash, 0, sizeof(*hash));
+  if(fastmatch) {
+    hash->fast = (size_t*)lodepng_malloc(sizeof(size_t) << FAST_HASH_BITS);
+    if(!hash->fast) return 83; /*alloc fail*/
+    lodepng_memset(hash->fast, 0, sizeof(size_t) << FAST_HASH_BITS);
+    return 0;
+  }
+
   hash->head = (int*)lodepng_malloc(sizeof(int) * HASH_NUM_VALUES);
   hash->val = (int*)lodepng_malloc(sizeof(int) * windowsize);
   hash->chain = (unsigned short*)lodepng_malloc(sizeof(unsigned short) * windowsize);
@@ -1516,6 +1529,8 @@ static void hash_cleanup(Hash* hash) {
   lodepng_free(hash->zeros);
   lodepng_free(hash->headz);
   lodepng_free(hash->chainz);
+
+  lodepng_free(hash->fast);
 }
 
 
@@ -1549,6 +1564,31 @@ static unsigned countZeros(const unsigned char* data, size_t size, size_t pos) {
   return (unsigned)(data - start);
 }
 
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define LODEPNG_WORD_MATCH /*compare 8 bytes at a time, the first differing byte is the lowest set bit*/
+#endif
+
+/*returns the first position from foreptr on that differs from backptr, or lastptr if all are equal.
+backptr lies before foreptr in the same buffer, so only foreptr needs bounds checking*/
+static LODEPNG_INLINE const unsigned char* matchEnd(const unsigned char* foreptr, const unsigned char* backptr,
+                                                    const unsigned char* lastptr) {
+#ifdef LODEPNG_WORD_MATCH
+  while(lastptr - foreptr >= 8) {
+    unsigned long long fore, back;
+    __builtin_memcpy(&fore, foreptr, 8);
+    __builtin_memcpy(&back, backptr, 8);
+    if(fore != back) return foreptr + (__builtin_ctzll(fore ^ back) >> 3);
+    foreptr += 8;
+    backptr += 8;
+  }
+#endif /*LODEPNG_WORD_MATCH*/
+  while(foreptr != lastptr && *backptr == *foreptr) {
+    ++backptr;
+    ++foreptr;
+  }
+  return foreptr;
+}
+
 /*wpos = pos & (windowsize - 1)*/
 static void updateHashChain(Hash* hash, size_t wpos, unsigned hashval, unsigned short numzeros) {
   hash->val[wpos] = (int)hashval;
@@ -1571,11 +1611,12 @@ this hash technique is one out of several ways to speed this up.
 */
 static unsigned encodeLZ77(uivector* out, Hash* hash,
                            const unsigned char* in, size_t inpos, size_t insize, unsigned windowsize,
-                           unsigned minmatch, unsigned nicematch, unsigned lazymatching) {
+                           unsigned minmatch, unsigned nicematch, unsigned lazymatching,
+                           unsigned maxchainlength) {
   size_t pos;
   unsigned i, error = 0;
   /*for large window lengths, assume the user wants no compression loss. Otherwise, max hash chain length speedup.*/
-  unsigned maxchainlength = windowsize >= 8192 ? windowsize : windowsize / 8u;
+  if(maxchainlength == 0) maxchainlength = windowsize >= 8192 ? windowsize : windowsize / 8u;
   unsigned maxlazymatch = windowsize >= 8192 ? MAX_SUPPORTED_DEFLATE_LENGTH : 64;
 
   unsigned usezeros = 1; /*not sure if setting it to false for windowsize < 8192 is better or worse*/
@@ -1640,10 +1681,7 @@ static unsigned encodeLZ77(uivector* out, Hash* hash,
           foreptr += skip;
         }
 
-        while(foreptr != lastptr && *backptr == *foreptr) /*maximum supported length by deflate is max length*/ {
-          ++backptr;
-          ++foreptr;
-        }
+        foreptr = matchEnd(foreptr, backptr, lastptr); /*maximum supported length by deflate is max length*/
         current_length = (unsigned)(foreptr - &in[pos]);
 
         if(current_length > length) {
@@ -1718,6 +1756,71 @@ static unsigned encodeLZ77(uivector* out, Hash* hash,
   return error;
 }
 
+static unsigned getFastHash(const unsigned char* data) {
+  unsigned value = (unsigned)data[0] | ((unsigned)data[1] << 8u) | ((unsigned)data[2] << 16u) | ((unsigned)data[3] << 24u);
+  return (unsigned)((value * 2654435761u) & 0xffffffffu) >> (32u - FAST_HASH_BITS);
+}
+
+/*
+LZ77-encode the data with a single probe per position, like the fastest levels of zlib:
+a 4-byte hash remembers only the last position it was seen at, and the match found
+there is taken or rejected without searching further or trying the next byte. Output
+format and return value are the same as encodeLZ77.
+*/
+static unsigned encodeLZ77Fast(uivector* out, Hash* hash,
+                               const unsigned char* in, size_t inpos, size_t insize, unsigned windowsize,
+                               unsigned minmatch) {
+  /*matches longer than this only hash their last positions, which keeps long runs of zeros cheap*/
+  const unsigned maxinsert = 16;
+  size_t pos = inpos;
+  unsigned error = 0;
+
+  if(windowsize == 0 || windowsize > 32768) return 60; /*error: windowsize smaller/larger than allowed*/
+  if((windowsize & (windowsize - 1)) != 0) return 90; /*error: must be power of two*/
+
+  if(minmatch < 4) minmatch = 4; /*the hash covers 4 bytes*/
+
+  while(pos < insize) {
+    unsigned length = 0;
+    size_t offset = 0;
+
+    if(insize - pos >= 4) {
+      unsigned hashval = getFastHash(&in[pos]);
+      size_t candidate = hash->fast[hashval];
+      hash->fast[hashval] = pos + 1;
+      if(candidate != 0 && pos - (candidate - 1) <= windowsize) {
+        const unsigned char* lastptr = &in[insize - pos < MAX_SUPPORTED_DEFLATE_LENGTH ?
+                                          insize : pos + MAX_SUPPORTED_DEFLATE_LENGTH];
+        offset = pos - (candidate - 1);
+        length = (unsigned)(matchEnd(&in[pos], &in[candidate - 1], lastptr) - &in[pos]);
+      }
+    }
+
+    if(length < minmatch) {
+      if(!uivector_push_back(out, in[pos])) ERROR_BREAK(83 /*alloc fail*/);
+      ++pos;
+    } else {
+      size_t i, end = pos + length;
+      addLengthDistance(out, length, offset);
+      i = length <= maxinsert ? pos + 1 : end - 2;
+      for(; i < end && insize - i >= 4; ++i) hash->fast[getFastHash(&in[i])] = i + 1;
+      pos = end;
+    }
+  }
+
+  return error;
+}
+
+/*runs the match finder chosen in the settings*/
+static unsigned encodeLZ77Settings(uivector* out, Hash* hash, const unsigned char* in, size_t inpos, size_t insize,
+                                   const LodePNGCompressSettings* settings) {
+  if(settings->fastmatch) {
+    return encodeLZ77Fast(out, hash, in, inpos, insize, settings->windowsize, settings->minmatch);
+  }
+  return encodeLZ77(out, hash, in, inpos, insize, settings->windowsize,
+                    settings->minmatch, settings->nicematch, settings->lazymatching, settings->maxchainlength);
+}
+
 /* /////////////////////////////////////////////////////////////////////////// */
 
 static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, size_t datasize) {
@@ -1844,8 +1947,7 @@ static unsigned deflateDynamic(LodePNGBitWriter* writer, Hash* hash,
     lodepng_memset(frequencies_cl, 0, NUM_CODE_LENGTH_CODES * sizeof(*frequencies_cl));
 
     if(settings->use_lz77) {
-      error = encodeLZ77(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
-                         settings->minmatch, settings->nicematch, settings->lazymatching);
+      error = encodeLZ77Settings(&lz77_encoded, hash, data, datapos, dataend, settings);
       if(error) break;
     } else {
       if(!uivector_resize(&lz77_encoded, datasize)) ERROR_BREAK(83 /*alloc fail*/);
@@ -2030,8 +2132,7 @@ static unsigned deflateFixed(LodePNGBitWriter* writer, Hash* hash,
     if(settings->use_lz77) /*LZ77 encoded*/ {
       uivector lz77_encoded;
       uivector_init(&lz77_encoded);
-      error = encodeLZ77(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
-                         settings->minmatch, settings->nicematch, settings->lazymatching);
+      error = encodeLZ77Settings(&lz77_encoded, hash, data, datapos, dataend, settings);
       if(!error) writeLZ77data(writer, &lz77_encoded, &tree_ll, &tree_d);
       uivector_cleanup(&lz77_encoded);
     } else /*no LZ77, but still will be Huffman compressed*/ {
@@ -2072,7 +2173,7 @@ static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t
   numdeflateblocks = (insize + blocksize - 1) / blocksize;
   if(numdeflateblocks == 0) numdeflateblocks = 1;
 
-  error = hash_init(&hash, settings->windowsize);
+  error = hash_init(&hash, settings->windowsize, settings->fastmatch);
 
   if(!error) {
     for(i = 0; i != numdeflateblocks && !error; ++i) {
@@ -2119,14 +2220,15 @@ static unsigned deflate(unsigned char** out, size_t* outsize,
 /* / Adler32                                                                / */
 /* ////////////////////////////////////////////////////////////////////////// */
 
-static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len) {
+#ifdef LODEPNG_COMPILE_ADLER32
+static unsigned update_adler32(unsigned adler, const unsigned char* data, size_t len) {
   unsigned s1 = adler & 0xffffu;
   unsigned s2 = (adler >> 16u) & 0xffffu;
 
   while(len != 0u) {
     unsigned i;
     /*at least 5552 sums can be done before the sums overflow, saving a lot of module divisions*/
-    unsigned amount = len > 5552u ? 5552u : len;
+    unsigned amount = len > 5552u ? 5552u : (unsigned)len;
     len -= amount;
     for(i = 0; i != amount; ++i) {
       s1 += (*data++);
@@ -2140,9 +2242,14 @@ static unsigned update_adler32(unsigned adler, const unsigned char* data, unsign
 }
 
 /*Return the adler32 of the bytes data[0..len-1]*/
-static unsigned adler32(const unsigned char* data, unsigned len) {
+unsigned lodepng_adler32(const unsigned char* data, size_t len) {
   return update_adler32(1u, data, len);
 }
+#else /* LODEPNG_COMPILE_ADLER32 */
+/*in this case, the function is only declared here, and must be defined externally
+so that it will be linked in*/
+unsigned lodepng_adler32(const unsigned char* data, size_t len);
+#endif /* LODEPNG_COMPILE_ADLER32 */
 
 /* ////////////////////////////////////////////////////////////////////////// */
 /* / Zlib                                                                   / */
@@ -2184,7 +2291,7 @@ static unsigned lodepng_zlib_decompressv(ucvector* out,
 
   if(!settings->ignore_adler32) {
     unsigned ADLER32 = lodepng_read32bitInt(&in[insize - 4]);
-    unsigned checksum = adler32(out->data, (unsigned)(out->size));
+    unsigned checksum = lodepng_adler32(out->data, out->size);
     if(checksum != ADLER32) return 58; /*error, adler checksum not correct, data must be corrupted*/
   }
 
@@ -2249,7 +2356,7 @@ unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsig
   }
 
   if(!error) {
-    unsigned ADLER32 = adler32(in, (unsigned)insize);
+    unsigned ADLER32 = lodepng_adler32(in, insize);
     /*zlib data: 1 byte CMF (CM+CINFO), 1 byte FLG, deflate data, 4 byte ADLER32 checksum of the Decompressed data*/
     unsigned CMF = 120; /*0b01111000: CM 8, CINFO 7. With CINFO 7, any window size up to 32768 can be used.*/
     unsigned FLEVEL = 0;
@@ -2317,13 +2424,15 @@ void lodepng_compress_settings_init(LodePNGCompressSettings* settings) {
   settings->minmatch = 3;
   settings->nicematch = 128;
   settings->lazymatching = 1;
+  settings->maxchainlength = 0;
+  settings->fastmatch = 0;
 
   settings->custom_zlib = 0;
   settings->custom_deflate = 0;
   settings->custom_context = 0;
 }
 
-const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 0};
+const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 0, 0, 0};
 
 
 #endif /*LODEPNG_COMPILE_ENCODER*/
@@ -4447,6 +4556,9 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   */
 
   size_t i;
+#ifdef LODEPNG_EXTERNAL_UNFILTER
+  if(bytewidth == 4) return lodepng_unfilter_scanline4(recon, scanline, precon, filterType, length);
+#endif /*LODEPNG_EXTERNAL_UNFILTER*/
   switch(filterType) {
     case 0:
       for(i = 0; i != length; ++i) recon[i] = scanline[i];
@@ -102,6 +102,19 @@ or comment out LODEPNG_COMPILE_CRC below*/
 #define LODEPNG_COMPILE_CRC
 #endif
 
+/*Disable built-in Adler32 function, in that case a custom implementation of
+lodepng_adler32 must be defined externally so that it can be linked in.*/
+#ifndef LODEPNG_NO_COMPILE_ADLER32
+/*pass -DLODEPNG_NO_COMPILE_ADLER32 to the compiler to disable the built-in one,
+or comment out LODEPNG_COMPILE_ADLER32 below*/
+#define LODEPNG_COMPILE_ADLER32
+#endif
+
+/*pass -DLODEPNG_EXTERNAL_UNFILTER to the compiler to have scanlines with 4 bytes per pixel (e.g. RGBA8)
+unfiltered by an externally defined lodepng_unfilter_scanline4, such as a SIMD implementation. It has
+the same contract as the built-in code: precon is NULL for the first scanline, recon and scanline may be
+the same memory, and it returns 36 for an illegal filter type.*/
+
 /*compile the C++ version (you can disable the C++ wrapper here even when compiling for C++)*/
 #ifdef __cplusplus
 #ifndef LODEPNG_NO_COMPILE_CPP
@@ -356,6 +369,13 @@ struct LodePNGCompressSettings /*deflate = compress*/ {
   unsigned minmatch; /*minimum lz77 length. 3 is normally best, 6 can be better for some PNGs. Default: 0*/
   unsigned nicematch; /*stop searching if >= this length found. Set to 258 for best compression. Default: 128*/
   unsigned lazymatching; /*use lazy matching: better compression but a bit slower. Default: true*/
+  /*maximum hash chain entries tried per position. Lower is faster but compresses less.
+  Default: 0, which means windowsize for windows of 8192 or more and windowsize / 8 below that*/
+  unsigned maxchainlength;
+  /*use the single probe matcher instead of hash chains: a 4-byte hash remembers only the last
+  position, so each byte costs one lookup. Several times faster, especially on noisy images,
+  but gives larger output. nicematch, lazymatching and maxchainlength are ignored. Default: false*/
+  unsigned fastmatch;
 
   /*use custom zlib encoder instead of built in one (default: null)*/
   unsigned (*custom_zlib)(unsigned char**, size_t*,
@@ -1097,6 +1117,12 @@ unsigned lodepng_chunk_create(unsigned char** out, size_t* outsize, size_t lengt
 
 /*Calculate CRC32 of buffer*/
 unsigned lodepng_crc32(const unsigned char* buf, size_t len);
+
+#if defined(LODEPNG_COMPILE_DECODER) && defined(LODEPNG_EXTERNAL_UNFILTER)
+/*Reverse the filter of one scanline with 4 bytes per pixel, see LODEPNG_EXTERNAL_UNFILTER*/
+unsigned lodepng_unfilter_scanline4(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                    unsigned char filterType, size_t length);
+#endif
 #endif /*LODEPNG_COMPILE_PNG*/
 
 
@@ -1107,6 +1133,9 @@ buffer. It cannot be used to create gzip files however, and it only supports the
 part of zlib that is required for PNG, it does not support dictionaries.
 */
 
+/*Calculate Adler32 of buffer, as stored in the zlib trailer*/
+unsigned lodepng_adler32(const unsigned char* buf, size_t len);
+
 #ifdef LODEPNG_COMPILE_DECODER
 /*Inflate a buffer. Inflate is the decompression step of deflate. Out buffer must be freed after use.*/
 unsigned lodepng_inflate(unsigned char** out, size_t* outsize,
@@ -0,0 +1,293 @@
+#include "checksum.h"
+#include "cpu_features.h"
+#include "../Include/lodepng.h"
+#include <cstring>
+#include <algorithm>
+
+#ifdef ENC_DEC_X86_SIMD
+#include <immintrin.h>
+#endif
+
+// ARMv8 CRC32 is an optional extension, so it is used when the compiler targets it (e.g. -march=native)
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__ARM_FEATURE_CRC32) && \
+    __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define ENC_DEC_ARM_CRC32 1
+#include <arm_acle.h>
+#endif
+
+using namespace std;
+
+const uint32_t CRC32_POLYNOMIAL = 0xEDB88320u; // bit-reflected 0x04C11DB7
+const size_t CRC32_FOLD_MINIMUM = 64;         // the folding kernel starts from four 16-byte blocks
+const uint32_t ADLER32_MODULUS = 65521;
+const size_t ADLER32_NMAX = 5552;             // most bytes summed before 32-bit sums could overflow
+const size_t ADLER32_BLOCK = 32;              // bytes per SIMD step
+
+// Kernels work on the raw register; crc32Update applies the pre- and post-inversion
+typedef uint32_t (*Crc32Kernel)(uint32_t, const unsigned char*, size_t);
+
+struct Crc32Tables {
+    uint32_t slice[8][256];
+};
+
+static Crc32Tables buildCrc32Tables() {
+    Crc32Tables tables;
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (CRC32_POLYNOMIAL & (0u - (crc & 1)));
+        }
+        tables.slice[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (int k = 1; k < 8; k++) {
+            const uint32_t previous = tables.slice[k - 1][i];
+            tables.slice[k][i] = (previous >> 8) ^ tables.slice[0][previous & 0xFF];
+        }
+    }
+    return tables;
+}
+
+// Slicing-by-8: one table lookup per byte, eight independent loads per step
+static uint32_t crc32Scalar(uint32_t crc, const unsigned char* data, size_t length) {
+    static const Crc32Tables tables = buildCrc32Tables();
+    const uint32_t (*t)[256] = tables.slice;
+    
+    while (length >= 8) {
+        crc ^= static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+               (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+        crc = t[7][crc & 0xFF] ^ t[6][(crc >> 8) & 0xFF] ^ t[5][(crc >> 16) & 0xFF] ^ t[4][crc >> 24] ^
+              t[3][data[4]] ^ t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+        data += 8;
+        length -= 8;
+    }
+    while (length--) {
+        crc = t[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef ENC_DEC_X86_SIMD
+// Carry-less multiply folding (Intel's "Fast CRC Computation Using PCLMULQDQ"):
+// four 128-bit lanes are folded 64 bytes at a time, then merged and reduced to
+// 32 bits with a Barrett reduction. Constants are x^k mod P for the reflected polynomial.
+SIMD_TARGET("pclmul,sse4.1")
+static uint32_t crc32Pclmul(uint32_t crc, const unsigned char* data, size_t length) {
+    if (length < CRC32_FOLD_MINIMUM) {
+        return crc32Scalar(crc, data, length);
+    }
+    
+    const __m128i k1k2 = _mm_set_epi64x(0x1c6e41596LL, 0x154442bd4LL);
+    const __m128i k3k4 = _mm_set_epi64x(0x0ccaa009eLL, 0x1751997d0LL);
+    const __m128i k5 = _mm_set_epi64x(0, 0x163cd6124LL);
+    const __m128i poly = _mm_set_epi64x(0x1f7011641LL, 0x1db710641LL);
+    const __m128i low32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    
+    __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+    __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32));
+    __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+    data += 64;
+    length -= 64;
+    
+    while (length >= 64) {
+        const __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        const __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        const __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        const __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48)));
+        data += 64;
+        length -= 64;
+    }
+    
+    // Fold the four lanes into one, then any remaining whole 16-byte blocks
+    const __m128i rest[3] = {x2, x3, x4};
+    for (int i = 0; i < 3; i++) {
+        const __m128i low = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, rest[i]), low);
+    }
+    while (length >= 16) {
+        const __m128i low = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data))), low);
+        data += 16;
+        length -= 16;
+    }
+    
+    // 128 -> 64 bits
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, low32);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(x1, k5, 0x00), x2);
+    
+    // Barrett reduction to 32 bits
+    x2 = _mm_and_si128(x1, low32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, low32);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    
+    return crc32Scalar(static_cast<uint32_t>(_mm_extract_epi32(x1, 1)), data, length);
+}
+#endif
+
+#ifdef ENC_DEC_ARM_CRC32
+static uint32_t crc32Arm(uint32_t crc, const unsigned char* data, size_t length) {
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, data, 8);
+        crc = __crc32d(crc, word);
+        data += 8;
+        length -= 8;
+    }
+    while (length--) {
+        crc = __crc32b(crc, *data++);
+    }
+    return crc;
+}
+#endif
+
+static Crc32Kernel selectCrc32Kernel() {
+#ifdef ENC_DEC_X86_SIMD
+    if (cpuFeatures().pclmul && cpuFeatures().sse41) return crc32Pclmul;
+#endif
+#ifdef ENC_DEC_ARM_CRC32
+    return crc32Arm;
+#endif
+    return crc32Scalar;
+}
+
+uint32_t crc32Update(uint32_t crc, const unsigned char* data, size_t length) {
+    static const Crc32Kernel kernel = selectCrc32Kernel();
+    return ~kernel(~crc, data, length);
+}
+
+// Replaces lodepng's built-in table version (LODEPNG_NO_COMPILE_CRC)
+unsigned lodepng_crc32(const unsigned char* data, size_t length) {
+    return crc32Update(0, data, length);
+}
+
+// Adler-32 kernels take the two running sums and return them reduced mod 65521
+typedef void (*Adler32Kernel)(uint32_t&, uint32_t&, const unsigned char*, size_t);
+
+static void adler32Scalar(uint32_t& s1, uint32_t& s2, const unsigned char* data, size_t length) {
+    while (length > 0) {
+        const size_t count = min(length, ADLER32_NMAX);
+        length -= count;
+        for (size_t i = 0; i < count; i++) {
+            s1 += data[i];
+            s2 += s1;
+        }
+        data += count;
+        s1 %= ADLER32_MODULUS;
+        s2 %= ADLER32_MODULUS;
+    }
+}
+
+#ifdef ENC_DEC_X86_SIMD
+// Per 32-byte block: s1 grows by the byte sum (psadbw) and s2 by the bytes
+// weighted 32..1 (pmaddubsw), plus 32 times s1 as it stood before the block.
+// That last term is gathered in prefix, which sums s1 over the blocks.
+SIMD_TARGET("ssse3")
+static void adler32Ssse3(uint32_t& s1, uint32_t& s2, const unsigned char* data, size_t length) {
+    const __m128i tapsHigh = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+    const __m128i tapsLow = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+    
+    size_t blocks = length / ADLER32_BLOCK;
+    while (blocks > 0) {
+        const size_t count = min(blocks, ADLER32_NMAX / ADLER32_BLOCK);
+        blocks -= count;
+        
+        __m128i prefix = _mm_cvtsi32_si128(static_cast<int>(s1 * count));
+        __m128i sum1 = zero;
+        __m128i sum2 = _mm_cvtsi32_si128(static_cast<int>(s2));
+        for (size_t i = 0; i < count; i++) {
+            const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+            const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+            prefix = _mm_add_epi32(prefix, sum1);
+            sum1 = _mm_add_epi32(sum1, _mm_add_epi32(_mm_sad_epu8(high, zero), _mm_sad_epu8(low, zero)));
+            sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_maddubs_epi16(high, tapsHigh), ones));
+            sum2 = _mm_add_epi32(sum2, _mm_madd_epi16(_mm_maddubs_epi16(low, tapsLow), ones));
+            data += ADLER32_BLOCK;
+        }
+        sum2 = _mm_add_epi32(sum2, _mm_slli_epi32(prefix, 5));
+        
+        sum1 = _mm_add_epi32(sum1, _mm_shuffle_epi32(sum1, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, _MM_SHUFFLE(2, 3, 0, 1)));
+        sum2 = _mm_add_epi32(sum2, _mm_shuffle_epi32(sum2, _MM_SHUFFLE(1, 0, 3, 2)));
+        s1 = (s1 + static_cast<uint32_t>(_mm_cvtsi128_si32(sum1))) % ADLER32_MODULUS;
+        s2 = static_cast<uint32_t>(_mm_cvtsi128_si32(sum2)) % ADLER32_MODULUS;
+    }
+    adler32Scalar(s1, s2, data, length % ADLER32_BLOCK);
+}
+
+// Same scheme as the SSSE3 kernel, with a whole 32-byte block per register
+SIMD_TARGET("avx2")
+static void adler32Avx2(uint32_t& s1, uint32_t& s2, const unsigned char* data, size_t length) {
+    const __m256i taps = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+                                          16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi16(1);
+    
+    size_t blocks = length / ADLER32_BLOCK;
+    while (blocks > 0) {
+        const size_t count = min(blocks, ADLER32_NMAX / ADLER32_BLOCK);
+        blocks -= count;
+        
+        __m256i prefix = _mm256_setr_epi32(static_cast<int>(s1 * count), 0, 0, 0, 0, 0, 0, 0);
+        __m256i sum1 = zero;
+        __m256i sum2 = _mm256_setr_epi32(static_cast<int>(s2), 0, 0, 0, 0, 0, 0, 0);
+        for (size_t i = 0; i < count; i++) {
+            const __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+            prefix = _mm256_add_epi32(prefix, sum1);
+            sum1 = _mm256_add_epi32(sum1, _mm256_sad_epu8(bytes, zero));
+            sum2 = _mm256_add_epi32(sum2, _mm256_madd_epi16(_mm256_maddubs_epi16(bytes, taps), ones));
+            data += ADLER32_BLOCK;
+        }
+        sum2 = _mm256_add_epi32(sum2, _mm256_slli_epi32(prefix, 5));
+        
+        __m128i total1 = _mm_add_epi32(_mm256_castsi256_si128(sum1), _mm256_extracti128_si256(sum1, 1));
+        __m128i total2 = _mm_add_epi32(_mm256_castsi256_si128(sum2), _mm256_extracti128_si256(sum2, 1));
+        total1 = _mm_add_epi32(total1, _mm_shuffle_epi32(total1, _MM_SHUFFLE(1, 0, 3, 2)));
+        total2 = _mm_add_epi32(total2, _mm_shuffle_epi32(total2, _MM_SHUFFLE(2, 3, 0, 1)));
+        total2 = _mm_add_epi32(total2, _mm_shuffle_epi32(total2, _MM_SHUFFLE(1, 0, 3, 2)));
+        s1 = (s1 + static_cast<uint32_t>(_mm_cvtsi128_si32(total1))) % ADLER32_MODULUS;
+        s2 = static_cast<uint32_t>(_mm_cvtsi128_si32(total2)) % ADLER32_MODULUS;
+    }
+    adler32Scalar(s1, s2, data, length % ADLER32_BLOCK);
+}
+#endif
+
+static Adler32Kernel selectAdler32Kernel() {
+#ifdef ENC_DEC_X86_SIMD
+    if (cpuFeatures().avx2) return adler32Avx2;
+    if (cpuFeatures().ssse3) return adler32Ssse3;
+#endif
+    return adler32Scalar;
+}
+
+uint32_t adler32Update(uint32_t adler, const unsigned char* data, size_t length) {
+    static const Adler32Kernel kernel = selectAdler32Kernel();
+    uint32_t s1 = adler & 0xFFFF;
+    uint32_t s2 = adler >> 16;
+    kernel(s1, s2, data, length);
+    return (s2 << 16) | s1;
+}
+
+// Replaces lodepng's scalar version (LODEPNG_NO_COMPILE_ADLER32)
+unsigned lodepng_adler32(const unsigned char* data, size_t length) {
+    return adler32Update(1, data, length);
+}
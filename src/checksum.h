@@ -0,0 +1,15 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Checksums used by the PNG container. Kernels are picked at runtime:
+// PCLMULQDQ folding (or the ARMv8 CRC32 instructions) for CRC-32, with a
+// slicing-by-8 table as the fallback; AVX2/SSSE3 for Adler-32, with a scalar
+// fallback. lodepng_crc32 and lodepng_adler32 are defined on top of these, so
+// lodepng is built with LODEPNG_NO_COMPILE_CRC and LODEPNG_NO_COMPILE_ADLER32.
+
+// Continues a CRC-32 (the PNG/zlib polynomial); start with crc = 0
+uint32_t crc32Update(uint32_t crc, const unsigned char* data, size_t length);
+// Continues an Adler-32 (the zlib trailer checksum); start with adler = 1
+uint32_t adler32Update(uint32_t adler, const unsigned char* data, size_t length);
@@ -0,0 +1,384 @@
+#include "container.h"
+#include "image_utils.h"
+#include "image_header.h"
+#include "crypto_utils.h"
+#include "permutation.h"
+#include "reed_solomon.h"
+#include "png_codec.h"
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+using namespace std;
+
+struct ContainerEntry {
+    string name;
+    uint32_t slotStart;
+    uint32_t length; // ciphertext bytes; RS parity follows them in the slots
+    unsigned char iv[AES_BLOCK_SIZE]; // cipherIvSize(cipher) bytes used
+    unsigned char tag[HMAC_SIZE];     // cipherTagSize(cipher) bytes used
+};
+
+// A decoded container image with its key material and parsed index
+struct Container {
+    vector<unsigned char> image;
+    unsigned width;
+    unsigned height;
+    ImageHeader header;
+    string key;
+    unsigned seed;
+    vector<ContainerEntry> entries;
+};
+
+static void appendLittleEndian32(string& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+static uint32_t readLittleEndian32(const unsigned char* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(in[i]) << (i * 8);
+    }
+    return value;
+}
+
+// Index: entry count, then per entry name length, name, slot start, length, IV, tag.
+// The IV and tag are as long as the container's cipher needs.
+static string serializeIndex(const vector<ContainerEntry>& entries, unsigned char cipher) {
+    const size_t ivSize = cipherIvSize(cipher);
+    const size_t tagSize = cipherTagSize(cipher);
+    string out;
+    appendLittleEndian32(out, static_cast<uint32_t>(entries.size()));
+    for (const auto& entry : entries) {
+        out.push_back(static_cast<char>(entry.name.length()));
+        out += entry.name;
+        appendLittleEndian32(out, entry.slotStart);
+        appendLittleEndian32(out, entry.length);
+        out.append(reinterpret_cast<const char*>(entry.iv), ivSize);
+        out.append(reinterpret_cast<const char*>(entry.tag), tagSize);
+    }
+    return out;
+}
+
+static bool parseIndex(const string& data, unsigned char cipher, vector<ContainerEntry>& entries) {
+    const size_t ivSize = cipherIvSize(cipher);
+    const size_t tagSize = cipherTagSize(cipher);
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data.data());
+    const size_t size = data.length();
+    if (size < 4) {
+        return false;
+    }
+    
+    const uint32_t count = readLittleEndian32(bytes);
+    size_t pos = 4;
+    entries.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        if (pos >= size) return false;
+        const size_t nameLength = bytes[pos++];
+        if (pos + nameLength + 8 + ivSize + tagSize > size) return false;
+        
+        ContainerEntry entry;
+        entry.name.assign(data, pos, nameLength);
+        pos += nameLength;
+        entry.slotStart = readLittleEndian32(bytes + pos);
+        entry.length = readLittleEndian32(bytes + pos + 4);
+        pos += 8;
+        memcpy(entry.iv, bytes + pos, ivSize);
+        pos += ivSize;
+        memcpy(entry.tag, bytes + pos, tagSize);
+        pos += tagSize;
+        entries.push_back(entry);
+    }
+    return pos == size;
+}
+
+// The index grows downwards from the last slot so entries can grow upwards from slot 0
+static size_t indexSlot(const IndexPermutation& slots, size_t byte) {
+    return slots(slots.size() - 1 - byte);
+}
+
+static size_t entriesEnd(const Container& container, const ReedSolomon& code) {
+    size_t end = 0;
+    for (const auto& entry : container.entries) {
+        end = max(end, entry.slotStart + entry.length + code.parityLength(entry.length));
+    }
+    return end;
+}
+
+static bool createContainer(Container& container) {
+    container.width = COVER_WIDTH;
+    container.height = COVER_HEIGHT;
+    container.image.resize(static_cast<size_t>(container.width) * container.height * 4);
+    
+    uint64_t coverSeed;
+    if (!randomSeed(coverSeed)) {
+        return false;
+    }
+    generateCoverImage(container.image, container.width, container.height, coverSeed);
+    
+    const string salt = generateRandomString(HEADER_SALT_SIZE);
+    if (salt.empty()) {
+        return false;
+    }
+    container.header = ImageHeader();
+    container.header.version = HEADER_VERSION;
+    container.header.layout = IMAGE_LAYOUT_CONTAINER;
+    container.header.cipher = DEFAULT_CIPHER;
+    container.header.codec = PAYLOAD_CODEC_REED_SOLOMON;
+    container.header.payloadParity = static_cast<unsigned char>(PAYLOAD_PARITY);
+    container.header.kdf = kdfSettings();
+    memcpy(container.header.salt, salt.data(), HEADER_SALT_SIZE);
+    
+    if (!deriveImageKey(salt, container.header.kdf, container.key, container.seed)) {
+        cerr << "Error: Key derivation failed." << endl;
+        return false;
+    }
+    container.entries.clear();
+    return true;
+}
+
+static bool loadContainer(const string& filename, Container& container) {
+    unsigned error = decodePng(container.image, container.width, container.height, filename);
+    if (error) {
+        cerr << "Error decoding image: " << lodepng_error_text(error) << endl;
+        return false;
+    }
+    
+    size_t repaired = 0;
+    const size_t headerBytes = min(container.image.size(), HEADER_MAX_SIZE);
+    if (readImageHeader(container.image.data(), headerBytes, container.header, repaired) == 0) {
+        return false;
+    }
+    if (repaired > 0) {
+        cerr << "Warning: Header was corrupted but repaired using parity (" << repaired << " bytes)." << endl;
+    }
+    
+    const ImageHeader& header = container.header;
+    if (header.layout != IMAGE_LAYOUT_CONTAINER) {
+        cerr << "Error: " << filename << " is not a container." << endl;
+        return false;
+    }
+    if (header.codec != PAYLOAD_CODEC_REED_SOLOMON || header.payloadParity == 0) {
+        cerr << "Error: Unsupported container parameters." << endl;
+        return false;
+    }
+    if (!validateKdfSettings(header.kdf)) {
+        return false;
+    }
+    
+    const string salt(reinterpret_cast<const char*>(header.salt), HEADER_SALT_SIZE);
+    if (!deriveImageKey(salt, header.kdf, container.key, container.seed)) {
+        cerr << "Error: Key derivation failed." << endl;
+        return false;
+    }
+    
+    const IndexPermutation slots(dataSlotCount(container.image.size()), container.seed);
+    const ReedSolomon code(header.payloadParity);
+    const size_t length = header.payloadLength;
+    const size_t stored = length + code.parityLength(length);
+    if (length == 0 || stored > slots.size()) {
+        cerr << "Error: Invalid container index size." << endl;
+        return false;
+    }
+    
+    vector<unsigned char> index(stored);
+    for (size_t i = 0; i < stored; i++) {
+        index[i] = container.image[slotOffset(indexSlot(slots, i))];
+    }
+    if (!code.decode(index.data(), length)) {
+        cerr << "Error: Container index is corrupted beyond repair." << endl;
+        return false;
+    }
+    index.resize(length);
+    
+    string plain;
+    const vector<unsigned char> iv(header.iv, header.iv + cipherIvSize(header.cipher));
+    const vector<unsigned char> tag(header.authTag, header.authTag + cipherTagSize(header.cipher));
+    if (!openData(header.cipher, index, container.key, iv, "", tag, plain)) {
+        cerr << "Error: Container index failed authentication." << endl;
+        return false;
+    }
+    if (!parseIndex(plain, header.cipher, container.entries)) {
+        cerr << "Error: Container index is malformed." << endl;
+        return false;
+    }
+    return true;
+}
+
+// Re-encrypts the index into the top slots, rewrites the header and encodes the PNG once
+static bool saveContainer(const string& filename, Container& container) {
+    const IndexPermutation slots(dataSlotCount(container.image.size()), container.seed);
+    const ReedSolomon code(container.header.payloadParity);
+    
+    const unsigned char cipher = container.header.cipher;
+    vector<unsigned char> iv(cipherIvSize(cipher));
+    if (!randomBytes(iv.data(), iv.size())) {
+        return false;
+    }
+    vector<unsigned char> index;
+    vector<unsigned char> tag;
+    if (!sealData(cipher, serializeIndex(container.entries, cipher), container.key, iv, "", index, tag)) {
+        return false;
+    }
+    
+    const size_t length = index.size();
+    index.resize(length + code.parityLength(length));
+    code.encode(index.data(), length, index.data() + length);
+    
+    if (entriesEnd(container, code) + index.size() > slots.size()) {
+        cerr << "Error: Container is full." << endl;
+        return false;
+    }
+    for (size_t i = 0; i < index.size(); i++) {
+        container.image[slotOffset(indexSlot(slots, i))] = index[i];
+    }
+    
+    ImageHeader& header = container.header;
+    header.payloadLength = static_cast<uint32_t>(length);
+    memcpy(header.iv, iv.data(), iv.size());
+    memcpy(header.authTag, tag.data(), min(tag.size(), cipherTagSize(cipher)));
+    writeImageHeader(header, container.image.data());
+    
+    // Write next to the original and swap it in, so a failed encode leaves the old container intact
+    const string temporary = filename + ".tmp";
+    unsigned error = encodePng(temporary, container.image, container.width, container.height);
+    if (error) {
+        cerr << "Error encoding image: " << lodepng_error_text(error) << endl;
+        remove(temporary.c_str());
+        return false;
+    }
+    if (rename(temporary.c_str(), filename.c_str()) != 0) {
+        // Windows will not rename over an existing file
+        remove(filename.c_str());
+        if (rename(temporary.c_str(), filename.c_str()) != 0) {
+            cerr << "Error: Cannot replace " << filename << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool containerAdd(const string& filename, const string& name, const string& secret) {
+    if (name.empty() || name.length() > CONTAINER_MAX_NAME) {
+        cerr << "Error: Entry names must be 1 to " << CONTAINER_MAX_NAME << " bytes long." << endl;
+        return false;
+    }
+    
+    Container container;
+    FILE* existing = fopen(filename.c_str(), "rb");
+    if (existing != nullptr) {
+        fclose(existing);
+        if (!loadContainer(filename, container)) {
+            return false;
+        }
+    } else if (!createContainer(container)) {
+        return false;
+    }
+    
+    for (const auto& entry : container.entries) {
+        if (entry.name == name) {
+            cerr << "Error: Entry \"" << name << "\" already exists." << endl;
+            return false;
+        }
+    }
+    
+    ContainerEntry entry;
+    entry.name = name;
+    // The entry name is bound to the ciphertext, so entries cannot be swapped in the index
+    const unsigned char cipher = container.header.cipher;
+    vector<unsigned char> iv(cipherIvSize(cipher));
+    if (!randomBytes(iv.data(), iv.size())) {
+        return false;
+    }
+    vector<unsigned char> ciphertext;
+    vector<unsigned char> tag;
+    if (!sealData(cipher, secret, container.key, iv, name, ciphertext, tag)) {
+        return false;
+    }
+    memcpy(entry.iv, iv.data(), iv.size());
+    memcpy(entry.tag, tag.data(), min(tag.size(), cipherTagSize(cipher)));
+    
+    const IndexPermutation slots(dataSlotCount(container.image.size()), container.seed);
+    const ReedSolomon code(container.header.payloadParity);
+    entry.slotStart = static_cast<uint32_t>(entriesEnd(container, code));
+    entry.length = static_cast<uint32_t>(ciphertext.size());
+    
+    ciphertext.resize(entry.length + code.parityLength(entry.length));
+    code.encode(ciphertext.data(), entry.length, ciphertext.data() + entry.length);
+    if (entry.slotStart + ciphertext.size() > slots.size()) {
+        cerr << "Error: Container is full." << endl;
+        return false;
+    }
+    for (size_t i = 0; i < ciphertext.size(); i++) {
+        container.image[slotOffset(slots(entry.slotStart + i))] = ciphertext[i];
+    }
+    
+    container.entries.push_back(entry);
+    return saveContainer(filename, container);
+}
+
+bool containerGet(const string& filename, const string& name, string& secret) {
+    Container container;
+    if (!loadContainer(filename, container)) {
+        return false;
+    }
+    
+    const ContainerEntry* found = nullptr;
+    for (const auto& entry : container.entries) {
+        if (entry.name == name) {
+            found = &entry;
+            break;
+        }
+    }
+    if (found == nullptr) {
+        cerr << "Error: No entry named \"" << name << "\"." << endl;
+        return false;
+    }
+    
+    // Only this entry's slots are read, repaired, verified and decrypted
+    const IndexPermutation slots(dataSlotCount(container.image.size()), container.seed);
+    const ReedSolomon code(container.header.payloadParity);
+    const size_t stored = found->length + code.parityLength(found->length);
+    if (found->slotStart + stored > slots.size()) {
+        cerr << "Error: Entry \"" << name << "\" lies outside the image." << endl;
+        return false;
+    }
+    
+    vector<unsigned char> ciphertext(stored);
+    for (size_t i = 0; i < stored; i++) {
+        ciphertext[i] = container.image[slotOffset(slots(found->slotStart + i))];
+    }
+    size_t repaired = 0;
+    if (!code.decode(ciphertext.data(), found->length, vector<size_t>(), &repaired)) {
+        cerr << "Warning: Entry data is corrupted beyond what parity can repair." << endl;
+    } else if (repaired > 0) {
+        cerr << "Warning: Entry data was corrupted but repaired using parity (" << repaired << " bytes)." << endl;
+    }
+    ciphertext.resize(found->length);
+    
+    const unsigned char cipher = container.header.cipher;
+    const vector<unsigned char> iv(found->iv, found->iv + cipherIvSize(cipher));
+    const vector<unsigned char> tag(found->tag, found->tag + cipherTagSize(cipher));
+    if (!openData(cipher, ciphertext, container.key, iv, name, tag, secret)) {
+        cerr << "Error: Entry \"" << name << "\" failed authentication." << endl;
+        return false;
+    }
+    return true;
+}
+
+bool containerList(const string& filename, vector<string>& names) {
+    Container container;
+    if (!loadContainer(filename, container)) {
+        return false;
+    }
+    
+    names.clear();
+    for (const auto& entry : container.entries) {
+        names.push_back(entry.name);
+    }
+    return true;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Containers keep many named secrets in one cover image. The header's
+// payload is an encrypted, authenticated index stored from the top of the
+// slot space downwards; it records where each entry's ciphertext lives (from
+// slot 0 upwards) together with the entry's IV and authentication tag. Reading one entry
+// only verifies and decrypts that entry; adding one re-encodes the PNG once.
+const size_t CONTAINER_MAX_NAME = 255;
+
+// Adds a secret under a new name, creating the container if the file does not exist
+bool containerAdd(const std::string& filename, const std::string& name, const std::string& secret);
+bool containerGet(const std::string& filename, const std::string& name, std::string& secret);
+bool containerList(const std::string& filename, std::vector<std::string>& names);
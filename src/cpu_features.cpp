@@ -0,0 +1,48 @@
+#include "cpu_features.h"
+#include <cstdlib>
+
+#ifdef ENC_DEC_X86_SIMD
+#include <cpuid.h>
+#endif
+
+using namespace std;
+
+static CpuFeatures detectCpuFeatures() {
+    CpuFeatures features = CpuFeatures();
+    
+    if (getenv("ENC_DEC_NO_SIMD") != nullptr) {
+        return features;
+    }
+    
+#ifdef ENC_DEC_X86_SIMD
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return features;
+    }
+    
+    features.sse2 = (edx & bit_SSE2) != 0;
+    features.ssse3 = (ecx & bit_SSSE3) != 0;
+    features.sse41 = (ecx & bit_SSE4_1) != 0;
+    features.pclmul = (ecx & bit_PCLMUL) != 0;
+    
+    // AVX registers are only usable if the OS saves them on context switch
+    bool osSavesYmm = false;
+    if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+        unsigned xcrLow, xcrHigh;
+        __asm__("xgetbv" : "=a"(xcrLow), "=d"(xcrHigh) : "c"(0));
+        osSavesYmm = (xcrLow & 0x6) == 0x6;
+    }
+    
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        features.avx2 = osSavesYmm && (ebx & bit_AVX2) != 0;
+        features.sha = (ebx & bit_SHA) != 0;
+    }
+#endif
+    
+    return features;
+}
+
+const CpuFeatures& cpuFeatures() {
+    static const CpuFeatures features = detectCpuFeatures();
+    return features;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+// x86 SIMD kernels are compiled per function with target attributes and
+// picked at runtime, so the binary still runs on CPUs without AVX2 etc.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ENC_DEC_X86_SIMD 1
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+struct CpuFeatures {
+    bool sse2;
+    bool ssse3;
+    bool sse41;
+    bool pclmul; // carry-less multiply (pclmulqdq)
+    bool avx2;
+    bool sha; // SHA-NI (sha256rnds2/msg1/msg2)
+};
+
+// Detected once per process; setting ENC_DEC_NO_SIMD in the environment
+// forces every kernel onto its scalar fallback.
+const CpuFeatures& cpuFeatures();
@@ -1,32 +1,194 @@
 #include "crypto_utils.h"
 #include <iostream>
-#include <random>
-#include <iomanip>
-#include <sstream>
 #include <algorithm>
 #include <cstring>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#define ENC_DEC_OPENSSL3 1
+#endif
 
 using namespace std;
 
 const string PROGRAM_PASSWORD = "admin";
 
-bool checkAccessPassword(const string& password) {
-    return password == PROGRAM_PASSWORD;
+// Algorithms are fetched once per process. On OpenSSL 3 every EVP_sha256() /
+// EVP_aes_256_cbc() init would otherwise look the implementation up again.
+struct EvpAlgorithms {
+    const EVP_MD* sha256;
+    const EVP_CIPHER* aes256Cbc;
+    const EVP_CIPHER* aes256Gcm;
+#ifdef ENC_DEC_OPENSSL3
+    EVP_MAC* hmac;
+#endif
+};
+
+static EvpAlgorithms fetchAlgorithms() {
+    EvpAlgorithms algorithms;
+#ifdef ENC_DEC_OPENSSL3
+    algorithms.sha256 = EVP_MD_fetch(nullptr, "SHA256", nullptr);
+    algorithms.aes256Cbc = EVP_CIPHER_fetch(nullptr, "AES-256-CBC", nullptr);
+    algorithms.aes256Gcm = EVP_CIPHER_fetch(nullptr, "AES-256-GCM", nullptr);
+    algorithms.hmac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+    // Fall back to the built-in tables if a provider does not offer an algorithm
+    if (algorithms.sha256 == nullptr) algorithms.sha256 = EVP_sha256();
+    if (algorithms.aes256Cbc == nullptr) algorithms.aes256Cbc = EVP_aes_256_cbc();
+    if (algorithms.aes256Gcm == nullptr) algorithms.aes256Gcm = EVP_aes_256_gcm();
+#else
+    algorithms.sha256 = EVP_sha256();
+    algorithms.aes256Cbc = EVP_aes_256_cbc();
+    algorithms.aes256Gcm = EVP_aes_256_gcm();
+#endif
+    return algorithms;
 }
 
-string generateRandomString(size_t length) {
-    const string chars = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+static const EvpAlgorithms& evpAlgorithms() {
+    static const EvpAlgorithms algorithms = fetchAlgorithms();
+    return algorithms;
+}
+
+// Per-thread contexts, re-initialized for every operation instead of being
+// allocated and freed each time. Batch workers each get their own set.
+struct EvpContexts {
+    EVP_MD_CTX* digest;
+    EVP_CIPHER_CTX* cbc;
+    EVP_CIPHER_CTX* gcm;
+#ifdef ENC_DEC_OPENSSL3
+    EVP_MAC_CTX* hmac;
+#else
+    HMAC_CTX* hmac;
+#endif
+    
+    EvpContexts() : digest(EVP_MD_CTX_new()), cbc(EVP_CIPHER_CTX_new()), gcm(EVP_CIPHER_CTX_new()) {
+#ifdef ENC_DEC_OPENSSL3
+        hmac = nullptr;
+        if (evpAlgorithms().hmac != nullptr) {
+            hmac = EVP_MAC_CTX_new(evpAlgorithms().hmac);
+            char digestName[] = "SHA256";
+            const OSSL_PARAM params[] = {
+                OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digestName, 0),
+                OSSL_PARAM_construct_end()
+            };
+            if (hmac != nullptr && EVP_MAC_CTX_set_params(hmac, params) != 1) {
+                EVP_MAC_CTX_free(hmac);
+                hmac = nullptr;
+            }
+        }
+#else
+        hmac = HMAC_CTX_new();
+#endif
+    }
     
-    random_device rd;
-    mt19937 generator(rd());
-    uniform_int_distribution<> distribution(0, chars.size() - 1);
+    ~EvpContexts() {
+        EVP_MD_CTX_free(digest);
+        EVP_CIPHER_CTX_free(cbc);
+        EVP_CIPHER_CTX_free(gcm);
+#ifdef ENC_DEC_OPENSSL3
+        EVP_MAC_CTX_free(hmac);
+#else
+        HMAC_CTX_free(hmac);
+#endif
+    }
     
-    string result;
-    result.reserve(length);
+    EvpContexts(const EvpContexts&) = delete;
+    EvpContexts& operator=(const EvpContexts&) = delete;
+};
+
+static EvpContexts& evpContexts() {
+    static thread_local EvpContexts contexts;
+    return contexts;
+}
+
+// SHA-256 of the concatenated parts with the thread's digest context
+static bool sha256Digest(const void* first, size_t firstLength, const void* second, size_t secondLength,
+                         unsigned char* hash) {
+    EVP_MD_CTX* context = evpContexts().digest;
+    if (context == nullptr) {
+        cerr << "Error: Failed to create EVP_MD_CTX" << endl;
+        return false;
+    }
+    if (EVP_DigestInit_ex(context, evpAlgorithms().sha256, nullptr) != 1 ||
+        EVP_DigestUpdate(context, first, firstLength) != 1 ||
+        (secondLength > 0 && EVP_DigestUpdate(context, second, secondLength) != 1) ||
+        EVP_DigestFinal_ex(context, hash, nullptr) != 1) {
+        cerr << "Error: SHA-256 digest failed" << endl;
+        return false;
+    }
+    return true;
+}
+
+bool checkAccessPassword(const string& password) {
+    return password == PROGRAM_PASSWORD;
+}
+
+// Per-thread buffer of CSPRNG output, refilled from RAND_bytes in large blocks
+// so salts, IVs and filenames don't each pay for a generator call. Bytes are
+// wiped as they are handed out.
+struct RandomPool {
+    unsigned char bytes[RANDOM_POOL_SIZE];
+    size_t position;
+    
+    RandomPool() : position(RANDOM_POOL_SIZE) {}
+    ~RandomPool() { OPENSSL_cleanse(bytes, sizeof(bytes)); }
+};
+
+bool randomBytes(unsigned char* out, size_t length) {
+    static thread_local RandomPool pool;
+    while (length > 0) {
+        if (pool.position == RANDOM_POOL_SIZE) {
+            if (RAND_bytes(pool.bytes, static_cast<int>(RANDOM_POOL_SIZE)) != 1) {
+                cerr << "Error: Random number generator failed" << endl;
+                return false;
+            }
+            pool.position = 0;
+        }
+        
+        const size_t count = min(length, RANDOM_POOL_SIZE - pool.position);
+        memcpy(out, pool.bytes + pool.position, count);
+        OPENSSL_cleanse(pool.bytes + pool.position, count);
+        pool.position += count;
+        out += count;
+        length -= count;
+    }
+    return true;
+}
+
+bool randomSeed(uint64_t& seed) {
+    unsigned char bytes[8];
+    if (!randomBytes(bytes, sizeof(bytes))) {
+        return false;
+    }
     
-    for (size_t i = 0; i < length; ++i) {
-        result += chars[distribution(generator)];
+    seed = 0;
+    for (int i = 0; i < 8; i++) {
+        seed |= static_cast<uint64_t>(bytes[i]) << (i * 8);
     }
+    return true;
+}
+
+string generateRandomString(size_t length) {
+    static const char chars[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    const uint64_t charCount = sizeof(chars) - 1;
+    
+    string result(length, '\0');
+    unsigned char bytes[64];
+    for (size_t done = 0; done < length; ) {
+        const size_t count = min(length - done, sizeof(bytes) / 4);
+        if (!randomBytes(bytes, count * 4)) {
+            OPENSSL_cleanse(&result[0], length);
+            return "";
+        }
+        
+        // Each character scales 32 random bits to 0..61 with a multiply and shift
+        // instead of rejection sampling; the bias is below 62 / 2^32
+        for (size_t i = 0; i < count; i++) {
+            const uint32_t word = static_cast<uint32_t>(bytes[i * 4]) | (static_cast<uint32_t>(bytes[i * 4 + 1]) << 8) |
+                                  (static_cast<uint32_t>(bytes[i * 4 + 2]) << 16) |
+                                  (static_cast<uint32_t>(bytes[i * 4 + 3]) << 24);
+            result[done + i] = chars[(word * charCount) >> 32];
+        }
+        done += count;
+    }
+    OPENSSL_cleanse(bytes, sizeof(bytes));
     
     return result;
 }
@@ -45,7 +207,7 @@ string pbkdf2(const string& password, const string& salt, size_t keyLength, int
             password.c_str(), password.length(),
             reinterpret_cast<const unsigned char*>(salt.c_str()), salt.length(),
             iterations,
-            EVP_sha256(),
+            evpAlgorithms().sha256,
             keyLength, key) != 1) {
         cerr << "Error generating key using PBKDF2" << endl;
         delete[] key;
@@ -62,21 +224,17 @@ string pbkdf2(const string& password, const string& salt, size_t keyLength, int
 
 string sha256(const string& data) {
     unsigned char hash[SHA256_DIGEST_LENGTH];
+    if (!sha256Digest(data.data(), data.size(), nullptr, 0, hash)) {
+        return "";
+    }
     
-    EVP_MD_CTX* context = EVP_MD_CTX_new();
-    const EVP_MD* md = EVP_sha256();
-    
-    EVP_DigestInit_ex(context, md, nullptr);
-    EVP_DigestUpdate(context, data.c_str(), data.size());
-    EVP_DigestFinal_ex(context, hash, nullptr);
-    
-    EVP_MD_CTX_free(context);
-    
-    stringstream ss;
+    static const char HEX_DIGITS[] = "0123456789abcdef";
+    string result(SHA256_DIGEST_LENGTH * 2, '0');
     for (int i = 0; i < SHA256_DIGEST_LENGTH; i++) {
-        ss << hex << setw(2) << setfill('0') << static_cast<int>(hash[i]);
+        result[i * 2] = HEX_DIGITS[hash[i] >> 4];
+        result[i * 2 + 1] = HEX_DIGITS[hash[i] & 0x0F];
     }
-    return ss.str();
+    return result;
 }
 
 vector<unsigned char> aesEncrypt(const string& plaintext, const string& key, vector<unsigned char>& iv) {
@@ -86,9 +244,13 @@ vector<unsigned char> aesEncrypt(const string& plaintext, const string& key, vec
     
     vector<unsigned char> ciphertext(plaintext.length() + AES_BLOCK_SIZE);
     
-    ctx = EVP_CIPHER_CTX_new();
+    ctx = evpContexts().cbc;
+    if (!ctx) {
+        cerr << "Error: Failed to create cipher context." << endl;
+        return vector<unsigned char>();
+    }
     
-    EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, 
+    EVP_EncryptInit_ex(ctx, evpAlgorithms().aes256Cbc, NULL, 
                       reinterpret_cast<const unsigned char*>(key.c_str()), 
                       iv.data());
     
@@ -103,17 +265,16 @@ vector<unsigned char> aesEncrypt(const string& plaintext, const string& key, vec
     EVP_EncryptFinal_ex(ctx, ciphertext.data() + len, &len);
     ciphertext_len += len;
     
-    EVP_CIPHER_CTX_free(ctx);
-    
     ciphertext.resize(ciphertext_len);
     
     return ciphertext;
 }
 
-string aesDecrypt(const vector<unsigned char>& ciphertext, const string& key, const vector<unsigned char>& iv) {
+bool aesDecryptBytes(const vector<unsigned char>& ciphertext, const string& key, const vector<unsigned char>& iv,
+                     string& plaintext) {
     if (ciphertext.empty()) {
-        cout << "Error: Empty ciphertext." << endl;
-        return "";
+        cerr << "Error: Empty ciphertext." << endl;
+        return false;
     }
     
     EVP_CIPHER_CTX *ctx;
@@ -122,18 +283,17 @@ string aesDecrypt(const vector<unsigned char>& ciphertext, const string& key, co
     
     vector<unsigned char> plaintext_buf(ciphertext.size() + AES_BLOCK_SIZE);
     
-    ctx = EVP_CIPHER_CTX_new();
+    ctx = evpContexts().cbc;
     if (!ctx) {
-        cout << "Error: Failed to create cipher context." << endl;
-        return "";
+        cerr << "Error: Failed to create cipher context." << endl;
+        return false;
     }
     
-    if (EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), NULL, 
+    if (EVP_DecryptInit_ex(ctx, evpAlgorithms().aes256Cbc, NULL, 
                          reinterpret_cast<const unsigned char*>(key.c_str()), 
                          iv.data()) != 1) {
-        cout << "Error: Failed to initialize decryption." << endl;
-        EVP_CIPHER_CTX_free(ctx);
-        return "";
+        cerr << "Error: Failed to initialize decryption." << endl;
+        return false;
     }
     
     // Explicitly set padding mode (PKCS7 padding is the default)
@@ -141,55 +301,197 @@ string aesDecrypt(const vector<unsigned char>& ciphertext, const string& key, co
     
     if (EVP_DecryptUpdate(ctx, plaintext_buf.data(), &len, 
                        ciphertext.data(), ciphertext.size()) != 1) {
-        cout << "Error: Failed during decryption update." << endl;
-        EVP_CIPHER_CTX_free(ctx);
-        return "";
+        cerr << "Error: Failed during decryption update." << endl;
+        return false;
     }
     
     plaintext_len = len;
     
     int finalResult = EVP_DecryptFinal_ex(ctx, plaintext_buf.data() + len, &len);
     
-    EVP_CIPHER_CTX_free(ctx);
-    
     if (finalResult <= 0) {
-        cout << "Error: Decryption failed, possibly due to corrupted data or incorrect key/IV." << endl;
-        return "";
+        cerr << "Error: Decryption failed, possibly due to corrupted data or incorrect key/IV." << endl;
+        return false;
     }
     
     plaintext_len += len;
     
+    plaintext.assign(plaintext_buf.begin(), plaintext_buf.begin() + plaintext_len);
+    return true;
+}
+
+string aesDecrypt(const vector<unsigned char>& ciphertext, const string& key, const vector<unsigned char>& iv) {
+    string plaintext;
+    if (!aesDecryptBytes(ciphertext, key, iv, plaintext)) {
+        return "";
+    }
+    
     // Check if plaintext contains only valid characters
     bool isPrintable = true;
-    for (int i = 0; i < plaintext_len; i++) {
-        if (!isprint(plaintext_buf[i]) && !isspace(plaintext_buf[i])) {
+    for (size_t i = 0; i < plaintext.length(); i++) {
+        const unsigned char c = static_cast<unsigned char>(plaintext[i]);
+        if (!isprint(c) && !isspace(c)) {
             isPrintable = false;
             break;
         }
     }
     
     if (!isPrintable) {
-        cout << "Warning: Decrypted data contains non-printable characters, which may indicate corruption." << endl;
+        cerr << "Warning: Decrypted data contains non-printable characters, which may indicate corruption." << endl;
     }
     
     // The padding is automatically removed by EVP_DecryptFinal_ex, so we don't need to handle null bytes
-    return string(plaintext_buf.begin(), plaintext_buf.begin() + plaintext_len);
+    return plaintext;
+}
+
+bool aesGcmEncrypt(const string& plaintext, const string& key, const vector<unsigned char>& iv,
+                   const string& aad, vector<unsigned char>& ciphertext, vector<unsigned char>& tag) {
+    if (key.length() != static_cast<size_t>(AES_KEY_SIZE) || iv.size() != static_cast<size_t>(GCM_IV_SIZE)) {
+        cerr << "Error: Invalid AES-GCM key or IV size." << endl;
+        return false;
+    }
+    
+    EVP_CIPHER_CTX* ctx = evpContexts().gcm;
+    if (!ctx) {
+        cerr << "Error: Failed to create cipher context." << endl;
+        return false;
+    }
+    
+    // GCM is a stream mode: the ciphertext is exactly as long as the plaintext
+    ciphertext.resize(plaintext.length());
+    tag.resize(GCM_TAG_SIZE);
+    int len = 0;
+    
+    bool ok = EVP_EncryptInit_ex(ctx, evpAlgorithms().aes256Gcm, NULL,
+                                 reinterpret_cast<const unsigned char*>(key.data()), iv.data()) == 1;
+    if (ok && !aad.empty()) {
+        ok = EVP_EncryptUpdate(ctx, NULL, &len, reinterpret_cast<const unsigned char*>(aad.data()),
+                               static_cast<int>(aad.length())) == 1;
+    }
+    if (ok) {
+        ok = EVP_EncryptUpdate(ctx, ciphertext.data(), &len, reinterpret_cast<const unsigned char*>(plaintext.data()),
+                               static_cast<int>(plaintext.length())) == 1;
+    }
+    if (ok) {
+        ok = EVP_EncryptFinal_ex(ctx, ciphertext.data() + len, &len) == 1 &&
+             EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_GET_TAG, GCM_TAG_SIZE, tag.data()) == 1;
+    }
+    
+    if (!ok) {
+        cerr << "Error: AES-GCM encryption failed." << endl;
+    }
+    return ok;
+}
+
+bool aesGcmDecrypt(const vector<unsigned char>& ciphertext, const string& key, const vector<unsigned char>& iv,
+                   const string& aad, const vector<unsigned char>& tag, string& plaintext) {
+    if (key.length() != static_cast<size_t>(AES_KEY_SIZE) || iv.size() != static_cast<size_t>(GCM_IV_SIZE) ||
+        tag.size() != static_cast<size_t>(GCM_TAG_SIZE)) {
+        cerr << "Error: Invalid AES-GCM key, IV or tag size." << endl;
+        return false;
+    }
+    
+    EVP_CIPHER_CTX* ctx = evpContexts().gcm;
+    if (!ctx) {
+        cerr << "Error: Failed to create cipher context." << endl;
+        return false;
+    }
+    
+    vector<unsigned char> buffer(ciphertext.size());
+    int len = 0;
+    int plaintextLen = 0;
+    
+    bool ok = EVP_DecryptInit_ex(ctx, evpAlgorithms().aes256Gcm, NULL,
+                                 reinterpret_cast<const unsigned char*>(key.data()), iv.data()) == 1;
+    if (ok && !aad.empty()) {
+        ok = EVP_DecryptUpdate(ctx, NULL, &len, reinterpret_cast<const unsigned char*>(aad.data()),
+                               static_cast<int>(aad.length())) == 1;
+    }
+    if (ok) {
+        ok = EVP_DecryptUpdate(ctx, buffer.data(), &len, ciphertext.data(), static_cast<int>(ciphertext.size())) == 1;
+        plaintextLen = len;
+    }
+    if (ok) {
+        // The tag is checked by the final call; nothing is released if it does not match
+        ok = EVP_CIPHER_CTX_ctrl(ctx, EVP_CTRL_GCM_SET_TAG, GCM_TAG_SIZE,
+                                 const_cast<unsigned char*>(tag.data())) == 1 &&
+             EVP_DecryptFinal_ex(ctx, buffer.data() + plaintextLen, &len) > 0;
+    }
+    
+    if (!ok) {
+        OPENSSL_cleanse(buffer.data(), buffer.size());
+        return false;
+    }
+    plaintext.assign(buffer.begin(), buffer.begin() + plaintextLen + len);
+    OPENSSL_cleanse(buffer.data(), buffer.size());
+    return true;
+}
+
+size_t cipherIvSize(unsigned char cipher) {
+    switch (cipher) {
+        case CIPHER_AES_256_CBC_HMAC: return AES_BLOCK_SIZE;
+        case CIPHER_AES_256_GCM: return GCM_IV_SIZE;
+        default: return 0;
+    }
+}
+
+size_t cipherTagSize(unsigned char cipher) {
+    switch (cipher) {
+        case CIPHER_AES_256_CBC_HMAC: return HMAC_SIZE;
+        case CIPHER_AES_256_GCM: return GCM_TAG_SIZE;
+        default: return 0;
+    }
+}
+
+bool sealData(unsigned char cipher, const string& plaintext, const string& key, const vector<unsigned char>& iv,
+              const string& aad, vector<unsigned char>& ciphertext, vector<unsigned char>& tag) {
+    if (cipher == CIPHER_AES_256_GCM) {
+        return aesGcmEncrypt(plaintext, key, iv, aad, ciphertext, tag);
+    }
+    if (cipher != CIPHER_AES_256_CBC_HMAC) {
+        return false;
+    }
+    
+    vector<unsigned char> cbcIv = iv;
+    ciphertext = aesEncrypt(plaintext, key, cbcIv);
+    tag = generateHMAC(ciphertext, key);
+    return !ciphertext.empty();
+}
+
+bool openData(unsigned char cipher, const vector<unsigned char>& ciphertext, const string& key,
+              const vector<unsigned char>& iv, const string& aad, const vector<unsigned char>& tag, string& plaintext) {
+    if (cipher == CIPHER_AES_256_GCM) {
+        return aesGcmDecrypt(ciphertext, key, iv, aad, tag, plaintext);
+    }
+    if (cipher != CIPHER_AES_256_CBC_HMAC || !verifyHMAC(ciphertext, tag, key)) {
+        return false;
+    }
+    return aesDecryptBytes(ciphertext, key, iv, plaintext);
 }
 
 vector<unsigned char> generateHMAC(const vector<unsigned char>& data, const string& key) {
     vector<unsigned char> hmac(HMAC_SIZE);
-    unsigned int len = 0;
-    
-    // Use proper HMAC function instead of manual concatenation
-    unsigned char* result = HMAC(EVP_sha256(), 
-                                  key.c_str(), 
-                                  key.length(),
-                                  data.data(), 
-                                  data.size(),
-                                  hmac.data(), 
-                                  &len);
-    
-    if (result == nullptr) {
+    const unsigned char* keyBytes = reinterpret_cast<const unsigned char*>(key.data());
+    bool ok = false;
+    size_t len = 0;
+
+#ifdef ENC_DEC_OPENSSL3
+    EVP_MAC_CTX* context = evpContexts().hmac;
+    ok = context != nullptr &&
+         EVP_MAC_init(context, keyBytes, key.length(), nullptr) == 1 &&
+         EVP_MAC_update(context, data.data(), data.size()) == 1 &&
+         EVP_MAC_final(context, hmac.data(), &len, hmac.size()) == 1;
+#else
+    HMAC_CTX* context = evpContexts().hmac;
+    unsigned int hmacLength = 0;
+    ok = context != nullptr &&
+         HMAC_Init_ex(context, keyBytes, static_cast<int>(key.length()), evpAlgorithms().sha256, nullptr) == 1 &&
+         HMAC_Update(context, data.data(), data.size()) == 1 &&
+         HMAC_Final(context, hmac.data(), &hmacLength) == 1;
+    len = hmacLength;
+#endif
+    
+    if (!ok) {
         cerr << "Error: HMAC generation failed" << endl;
         return vector<unsigned char>(HMAC_SIZE, 0);
     }
@@ -212,41 +514,10 @@ bool verifyHMAC(const vector<unsigned char>& data, const vector<unsigned char>&
 unsigned deriveSeedFromKey(const string& key, const string& salt) {
     // Use SHA-256 to create a hash of key and salt
     unsigned char hash[SHA256_DIGEST_LENGTH];
-    
-    EVP_MD_CTX* context = EVP_MD_CTX_new();
-    if (context == nullptr) {
-        cerr << "Error: Failed to create EVP_MD_CTX" << endl;
-        return 0;
-    }
-    
-    const EVP_MD* md = EVP_sha256();
-    
-    if (EVP_DigestInit_ex(context, md, nullptr) != 1) {
-        cerr << "Error: Failed to initialize digest" << endl;
-        EVP_MD_CTX_free(context);
-        return 0;
-    }
-    
-    if (EVP_DigestUpdate(context, key.data(), key.size()) != 1) {
-        cerr << "Error: Failed to update digest with key" << endl;
-        EVP_MD_CTX_free(context);
-        return 0;
-    }
-    
-    if (EVP_DigestUpdate(context, salt.data(), salt.size()) != 1) {
-        cerr << "Error: Failed to update digest with salt" << endl;
-        EVP_MD_CTX_free(context);
+    if (!sha256Digest(key.data(), key.size(), salt.data(), salt.size(), hash)) {
         return 0;
     }
     
-    if (EVP_DigestFinal_ex(context, hash, nullptr) != 1) {
-        cerr << "Error: Failed to finalize digest" << endl;
-        EVP_MD_CTX_free(context);
-        return 0;
-    }
-    
-    EVP_MD_CTX_free(context);
-    
     // Convert first 4 bytes of hash to unsigned int
     // Using bit shifting for endian-independent conversion
     unsigned seed = 0;
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 #include <openssl/evp.h>
 #include <openssl/rand.h>
 #include <openssl/sha.h>
@@ -13,15 +14,50 @@ const int AES_KEY_SIZE = 32;
 const int AES_BLOCK_SIZE = 16;
 const int HMAC_SIZE = 32; // SHA-256 HMAC size
 const int PBKDF2_ITERATIONS = 100000; // Number of iterations for PBKDF2
+const int GCM_IV_SIZE = 12;
+const int GCM_TAG_SIZE = 16;
+const size_t RANDOM_POOL_SIZE = 4096; // CSPRNG bytes buffered per thread
+
+// Ciphers recorded in image headers
+const unsigned char CIPHER_AES_256_CBC_HMAC = 0; // 16-byte IV, HMAC-SHA256 over the ciphertext
+const unsigned char CIPHER_AES_256_GCM = 1;      // 12-byte IV, 16-byte tag
+const unsigned char DEFAULT_CIPHER = CIPHER_AES_256_GCM; // used for new images
 
 std::string sha256(const std::string& data);
 std::string deriveKey(const std::string& password, size_t keyLength);
 std::string pbkdf2(const std::string& password, const std::string& salt, size_t keyLength, int iterations);
 std::vector<unsigned char> aesEncrypt(const std::string& plaintext, const std::string& key, std::vector<unsigned char>& iv);
 std::string aesDecrypt(const std::vector<unsigned char>& ciphertext, const std::string& key, const std::vector<unsigned char>& iv);
+// Binary-safe variant without the printable-text check; false on failure
+bool aesDecryptBytes(const std::vector<unsigned char>& ciphertext, const std::string& key,
+                     const std::vector<unsigned char>& iv, std::string& plaintext);
+// Cryptographically secure random bytes from a per-thread pool; false if the generator fails
+bool randomBytes(unsigned char* out, size_t length);
+// 64 bits from randomBytes, for seeding non-cryptographic generators; false if the generator fails
+bool randomSeed(uint64_t& seed);
+// Base62 characters from randomBytes; empty if the generator fails
 std::string generateRandomString(size_t length);
 bool checkAccessPassword(const std::string& password);
 
+// AES-256-GCM: encrypts and authenticates (plaintext plus optional associated data) in one pass.
+// Decryption fails without output if the tag does not match.
+bool aesGcmEncrypt(const std::string& plaintext, const std::string& key, const std::vector<unsigned char>& iv,
+                   const std::string& aad, std::vector<unsigned char>& ciphertext, std::vector<unsigned char>& tag);
+bool aesGcmDecrypt(const std::vector<unsigned char>& ciphertext, const std::string& key, const std::vector<unsigned char>& iv,
+                   const std::string& aad, const std::vector<unsigned char>& tag, std::string& plaintext);
+
+// IV and authentication tag sizes for a cipher; 0 for unknown ciphers
+size_t cipherIvSize(unsigned char cipher);
+size_t cipherTagSize(unsigned char cipher);
+// Encrypts and authenticates with the given cipher (aad is only used by GCM), or
+// verifies and decrypts; openData fails without output if authentication fails
+bool sealData(unsigned char cipher, const std::string& plaintext, const std::string& key,
+              const std::vector<unsigned char>& iv, const std::string& aad,
+              std::vector<unsigned char>& ciphertext, std::vector<unsigned char>& tag);
+bool openData(unsigned char cipher, const std::vector<unsigned char>& ciphertext, const std::string& key,
+              const std::vector<unsigned char>& iv, const std::string& aad,
+              const std::vector<unsigned char>& tag, std::string& plaintext);
+
 // New HMAC functions
 std::vector<unsigned char> generateHMAC(const std::vector<unsigned char>& data, const std::string& key);
 bool verifyHMAC(const std::vector<unsigned char>& data, const std::vector<unsigned char>& hmac, const std::string& key);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+// SplitMix64 step, used to expand a single seed into generator state
+inline uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// xoshiro256** generator. Fast and statistically solid but NOT cryptographic:
+// only use it for cover image synthesis, never for keys, salts or IVs.
+// Satisfies UniformRandomBitGenerator, so std distributions accept it.
+class Xoshiro256 {
+public:
+    typedef uint64_t result_type;
+    
+    explicit Xoshiro256(uint64_t seed) {
+        for (int i = 0; i < 4; i++) {
+            s[i] = splitMix64(seed);
+        }
+    }
+    
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return ~static_cast<uint64_t>(0); }
+    
+    result_type operator()() {
+        const uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const uint64_t t = s[1] << 17;
+        
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        
+        return result;
+    }
+    
+private:
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+    
+    uint64_t s[4];
+};
@@ -0,0 +1,232 @@
+#include "image_header.h"
+#include "reed_solomon.h"
+#include <iostream>
+#include <cstring>
+
+using namespace std;
+
+// Preamble: magic[4], version, reserved, body length (16-bit LE)
+const size_t PREAMBLE_SIZE = 8;
+const size_t PREAMBLE_BODY_LENGTH = 6;
+
+// Version 1 body
+const size_t V1_CODEC = 0;
+const size_t V1_PAYLOAD_PARITY = 1;
+const size_t V1_KDF = 2;
+const size_t V1_LAYOUT = 3;
+const size_t V1_KDF_PARAMS = 4;
+const size_t V1_PAYLOAD_LENGTH = 16;
+const size_t V1_SALT = 20;
+const size_t V1_IV = V1_SALT + HEADER_SALT_SIZE;
+const size_t V1_HMAC = V1_IV + AES_BLOCK_SIZE;
+const size_t V1_HASH = V1_HMAC + HMAC_SIZE;
+const size_t V1_BODY_SIZE = V1_HASH + HEADER_HASH_SIZE;
+
+// Version 2 body: adds the cipher; the IV and tag are only as long as the cipher needs
+const size_t V2_CODEC = 0;
+const size_t V2_PAYLOAD_PARITY = 1;
+const size_t V2_KDF = 2;
+const size_t V2_LAYOUT = 3;
+const size_t V2_CIPHER = 4;
+const size_t V2_KDF_PARAMS = 8;
+const size_t V2_PAYLOAD_LENGTH = 20;
+const size_t V2_SALT = 24;
+const size_t V2_IV = V2_SALT + HEADER_SALT_SIZE;
+
+static void writeLittleEndian32(unsigned char* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = static_cast<unsigned char>((value >> (i * 8)) & 0xFF);
+    }
+}
+
+static uint32_t readLittleEndian32(const unsigned char* in) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(in[i]) << (i * 8);
+    }
+    return value;
+}
+
+// Body size for a version and cipher, or 0 if either is unknown
+static size_t bodySize(unsigned char version, unsigned char cipher) {
+    switch (version) {
+        case 1: return cipher == CIPHER_AES_256_CBC_HMAC ? V1_BODY_SIZE : 0;
+        case 2:
+            if (cipherIvSize(cipher) == 0) return 0;
+            return V2_IV + cipherIvSize(cipher) + cipherTagSize(cipher) + HEADER_HASH_SIZE;
+        default: return 0;
+    }
+}
+
+static void writeBodyV1(const ImageHeader& header, unsigned char* body) {
+    memset(body, 0, V1_BODY_SIZE);
+    body[V1_CODEC] = header.codec;
+    body[V1_PAYLOAD_PARITY] = header.payloadParity;
+    body[V1_KDF] = header.kdf.algorithm;
+    body[V1_LAYOUT] = header.layout;
+    for (int i = 0; i < 3; i++) {
+        writeLittleEndian32(body + V1_KDF_PARAMS + i * 4, header.kdf.params[i]);
+    }
+    writeLittleEndian32(body + V1_PAYLOAD_LENGTH, header.payloadLength);
+    memcpy(body + V1_SALT, header.salt, HEADER_SALT_SIZE);
+    memcpy(body + V1_IV, header.iv, AES_BLOCK_SIZE);
+    memcpy(body + V1_HMAC, header.authTag, HMAC_SIZE);
+    memcpy(body + V1_HASH, header.passwordHash, HEADER_HASH_SIZE);
+}
+
+static void readBodyV1(const unsigned char* body, ImageHeader& header) {
+    header.codec = body[V1_CODEC];
+    header.payloadParity = body[V1_PAYLOAD_PARITY];
+    header.kdf.algorithm = body[V1_KDF];
+    header.layout = body[V1_LAYOUT];
+    header.cipher = CIPHER_AES_256_CBC_HMAC;
+    for (int i = 0; i < 3; i++) {
+        header.kdf.params[i] = readLittleEndian32(body + V1_KDF_PARAMS + i * 4);
+    }
+    header.payloadLength = readLittleEndian32(body + V1_PAYLOAD_LENGTH);
+    memcpy(header.salt, body + V1_SALT, HEADER_SALT_SIZE);
+    memcpy(header.iv, body + V1_IV, AES_BLOCK_SIZE);
+    memcpy(header.authTag, body + V1_HMAC, HMAC_SIZE);
+    memcpy(header.passwordHash, body + V1_HASH, HEADER_HASH_SIZE);
+}
+
+static void writeBodyV2(const ImageHeader& header, unsigned char* body, size_t size) {
+    const size_t ivSize = cipherIvSize(header.cipher);
+    const size_t tagSize = cipherTagSize(header.cipher);
+    
+    memset(body, 0, size);
+    body[V2_CODEC] = header.codec;
+    body[V2_PAYLOAD_PARITY] = header.payloadParity;
+    body[V2_KDF] = header.kdf.algorithm;
+    body[V2_LAYOUT] = header.layout;
+    body[V2_CIPHER] = header.cipher;
+    for (int i = 0; i < 3; i++) {
+        writeLittleEndian32(body + V2_KDF_PARAMS + i * 4, header.kdf.params[i]);
+    }
+    writeLittleEndian32(body + V2_PAYLOAD_LENGTH, header.payloadLength);
+    memcpy(body + V2_SALT, header.salt, HEADER_SALT_SIZE);
+    memcpy(body + V2_IV, header.iv, ivSize);
+    memcpy(body + V2_IV + ivSize, header.authTag, tagSize);
+    memcpy(body + V2_IV + ivSize + tagSize, header.passwordHash, HEADER_HASH_SIZE);
+}
+
+static void readBodyV2(const unsigned char* body, ImageHeader& header) {
+    header.codec = body[V2_CODEC];
+    header.payloadParity = body[V2_PAYLOAD_PARITY];
+    header.kdf.algorithm = body[V2_KDF];
+    header.layout = body[V2_LAYOUT];
+    header.cipher = body[V2_CIPHER];
+    for (int i = 0; i < 3; i++) {
+        header.kdf.params[i] = readLittleEndian32(body + V2_KDF_PARAMS + i * 4);
+    }
+    header.payloadLength = readLittleEndian32(body + V2_PAYLOAD_LENGTH);
+    
+    const size_t ivSize = cipherIvSize(header.cipher);
+    const size_t tagSize = cipherTagSize(header.cipher);
+    memcpy(header.salt, body + V2_SALT, HEADER_SALT_SIZE);
+    memcpy(header.iv, body + V2_IV, ivSize);
+    memcpy(header.authTag, body + V2_IV + ivSize, tagSize);
+    memcpy(header.passwordHash, body + V2_IV + ivSize + tagSize, HEADER_HASH_SIZE);
+}
+
+size_t writeImageHeader(const ImageHeader& header, unsigned char* out) {
+    const size_t size = bodySize(header.version, header.cipher);
+    if (size == 0) {
+        return 0;
+    }
+    
+    const ReedSolomon preambleCode(HEADER_PREAMBLE_PARITY);
+    const ReedSolomon bodyCode(HEADER_BODY_PARITY);
+    
+    memcpy(out, HEADER_MAGIC, 4);
+    out[4] = header.version;
+    out[5] = 0;
+    out[PREAMBLE_BODY_LENGTH] = static_cast<unsigned char>(size & 0xFF);
+    out[PREAMBLE_BODY_LENGTH + 1] = static_cast<unsigned char>(size >> 8);
+    preambleCode.encode(out, PREAMBLE_SIZE, out + PREAMBLE_SIZE);
+    
+    unsigned char* body = out + PREAMBLE_SIZE + preambleCode.parityLength(PREAMBLE_SIZE);
+    switch (header.version) {
+        case 1: writeBodyV1(header, body); break;
+        case 2: writeBodyV2(header, body, size); break;
+    }
+    bodyCode.encode(body, size, body + size);
+    
+    return static_cast<size_t>(body - out) + size + bodyCode.parityLength(size);
+}
+
+// Repairs the preamble at the start of data into preamble; false if it does not carry the magic
+static bool decodePreamble(const unsigned char* data, size_t size, unsigned char* preamble, size_t& corrected) {
+    const ReedSolomon preambleCode(HEADER_PREAMBLE_PARITY);
+    const size_t preambleTotal = PREAMBLE_SIZE + preambleCode.parityLength(PREAMBLE_SIZE);
+    corrected = 0;
+    if (size < preambleTotal) {
+        return false;
+    }
+    
+    memcpy(preamble, data, preambleTotal);
+    return preambleCode.decode(preamble, PREAMBLE_SIZE, vector<size_t>(), &corrected) &&
+           memcmp(preamble, HEADER_MAGIC, 4) == 0;
+}
+
+bool hasImageHeader(const unsigned char* data, size_t size) {
+    unsigned char preamble[PREAMBLE_SIZE + HEADER_PREAMBLE_PARITY];
+    size_t corrected;
+    return decodePreamble(data, size, preamble, corrected);
+}
+
+size_t readImageHeader(const unsigned char* data, size_t size, ImageHeader& header, size_t& repaired) {
+    const ReedSolomon preambleCode(HEADER_PREAMBLE_PARITY);
+    const ReedSolomon bodyCode(HEADER_BODY_PARITY);
+    const size_t preambleTotal = PREAMBLE_SIZE + preambleCode.parityLength(PREAMBLE_SIZE);
+    repaired = 0;
+    
+    if (size < preambleTotal) {
+        cerr << "Error: Image is too small to hold a header." << endl;
+        return 0;
+    }
+    
+    unsigned char preamble[PREAMBLE_SIZE + HEADER_PREAMBLE_PARITY];
+    size_t corrected = 0;
+    if (!decodePreamble(data, size, preamble, corrected)) {
+        cerr << "Error: No password image header found." << endl;
+        return 0;
+    }
+    repaired += corrected;
+    
+    const unsigned char version = preamble[4];
+    const size_t length = preamble[PREAMBLE_BODY_LENGTH] | (preamble[PREAMBLE_BODY_LENGTH + 1] << 8);
+    // The cipher (and so the exact body size) is only known once the body is decoded
+    const bool knownSize = length != 0 && (length == bodySize(version, CIPHER_AES_256_CBC_HMAC) ||
+                                           length == bodySize(version, CIPHER_AES_256_GCM));
+    if (!knownSize) {
+        cerr << "Error: Unsupported image format version " << static_cast<unsigned>(version) << "." << endl;
+        return 0;
+    }
+    
+    const size_t total = preambleTotal + length + bodyCode.parityLength(length);
+    if (size < total) {
+        cerr << "Error: Image is too small to hold a header." << endl;
+        return 0;
+    }
+    
+    vector<unsigned char> body(data + preambleTotal, data + total);
+    if (!bodyCode.decode(body.data(), length, vector<size_t>(), &corrected)) {
+        cerr << "Error: Image header is corrupted beyond repair." << endl;
+        return 0;
+    }
+    repaired += corrected;
+    
+    header = ImageHeader();
+    header.version = version;
+    switch (version) {
+        case 1: readBodyV1(body.data(), header); break;
+        case 2: readBodyV2(body.data(), header); break;
+    }
+    
+    if (bodySize(version, header.cipher) != length) {
+        cerr << "Error: Unsupported cipher " << static_cast<unsigned>(header.cipher) << "." << endl;
+        return 0;
+    }
+    return total;
+}
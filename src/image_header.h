@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "crypto_utils.h"
+#include "kdf.h"
+
+// Every image starts with a protected header, read from the first row:
+//   preamble  magic "P2IH", version, body length     + HEADER_PREAMBLE_PARITY bytes
+//   body      version-specific fields (see below)     + HEADER_BODY_PARITY bytes
+// The preamble layout never changes, so a reader can always find out which
+// body follows and reject versions it does not know.
+const unsigned char HEADER_MAGIC[4] = {'P', '2', 'I', 'H'};
+const unsigned char HEADER_VERSION = 2; // written by encryptPassword; version 1 is still read
+const unsigned HEADER_PREAMBLE_PARITY = 8;
+const unsigned HEADER_BODY_PARITY = 32;
+const size_t HEADER_MAX_SIZE = 256; // preamble + largest body, parity included
+
+const size_t HEADER_SALT_SIZE = 16;
+const size_t HEADER_HASH_SIZE = 32; // leading hex digits of the password's SHA-256
+
+// Image layouts
+const unsigned char IMAGE_LAYOUT_SINGLE = 0;    // one secret, payload from slot 0
+const unsigned char IMAGE_LAYOUT_CONTAINER = 1; // encrypted index at the top of the slots, entries from slot 0
+
+struct ImageHeader {
+    unsigned char version;
+    unsigned char layout;         // IMAGE_LAYOUT_*
+    unsigned char codec;          // payload codec (PAYLOAD_CODEC_*)
+    unsigned char payloadParity;  // RS parity bytes per payload codeword
+    unsigned char cipher;         // CIPHER_* (always CBC + HMAC in version 1)
+    KdfSettings kdf;              // algorithm and cost parameters
+    uint32_t payloadLength;       // ciphertext bytes (the index, for containers)
+    unsigned char salt[HEADER_SALT_SIZE];
+    unsigned char iv[AES_BLOCK_SIZE];      // cipherIvSize(cipher) bytes used
+    unsigned char authTag[HMAC_SIZE];      // HMAC or GCM tag, cipherTagSize(cipher) bytes used
+    unsigned char passwordHash[HEADER_HASH_SIZE];
+};
+
+// Serializes header (at header.version) with its parity; returns the bytes written,
+// or 0 for an unknown version. out must hold HEADER_MAX_SIZE bytes.
+size_t writeImageHeader(const ImageHeader& header, unsigned char* out);
+
+// True if data starts with a (repairable) preamble carrying HEADER_MAGIC; images
+// without one predate the header and are read through legacy_image.h
+bool hasImageHeader(const unsigned char* data, size_t size);
+
+// Parses and repairs the header at the start of data. Returns the header size,
+// or 0 if the data has no readable header. repaired counts corrected bytes.
+size_t readImageHeader(const unsigned char* data, size_t size, ImageHeader& header, size_t& repaired);
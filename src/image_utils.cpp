@@ -1,442 +1,923 @@
 #include "image_utils.h"
 #include "crypto_utils.h"
+#include "permutation.h"
+#include "key_cache.h"
+#include "png_codec.h"
+#include "png_stream.h"
+#include "cpu_features.h"
+#include "fast_random.h"
+#include "vote.h"
+#include "reed_solomon.h"
+#include "image_header.h"
+#include "legacy_image.h"
+#include "pbkdf2_batch.h"
+#include "worker_pool.h"
 #include <iostream>
 #include <random>
 #include <algorithm>
 #include <dirent.h>
 #include <iomanip>
 #include <sstream>
-#include <map>
 #include <cmath>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+
+#ifdef ENC_DEC_X86_SIMD
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
 const string PROGRAM_PASSWORD = "admin"; // Moving this constant here since it's used in the image functions
 
-// Helper function to generate a smooth gradient
-void generateGradient(vector<unsigned char>& image, unsigned width, unsigned height, 
-                     const vector<unsigned char>& color1, const vector<unsigned char>& color2) {
-    // Pre-calculate width factor to avoid repeated division
-    const float widthInv = 1.0f / width;
-    const float heightInv = 1.0f / height;
-    
-    for (unsigned y = 0; y < height; y++) {
-        const float factor2 = y * heightInv;
-        size_t rowOffset = y * width * 4;
-        
-        for (unsigned x = 0; x < width; x++) {
-            const float factor = x * widthInv;
-            const float blend = 0.5f * (factor + factor2);
-            const float oneMinusBlend = 1.0f - blend;
-            
-            size_t idx = rowOffset + x * 4;
-            // Unroll loop for better performance
-            image[idx] = static_cast<unsigned char>(color1[0] * oneMinusBlend + color2[0] * blend);
-            image[idx + 1] = static_cast<unsigned char>(color1[1] * oneMinusBlend + color2[1] * blend);
-            image[idx + 2] = static_cast<unsigned char>(color1[2] * oneMinusBlend + color2[2] * blend);
-            image[idx + 3] = 255; // Alpha channel
+// Number of pixel slots available for embedding data between the metadata regions
+size_t dataSlotCount(size_t imageSize) {
+    return (imageSize - METADATA_BOUNDARY - DATA_EMBEDDING_START + 3) / 4;
+}
+
+// Byte offset of a data slot; data lives in the red channel of each slot's pixel
+size_t slotOffset(size_t slot) {
+    return DATA_EMBEDDING_START + slot * 4;
+}
+
+// Gradient rows are linear in x, so every channel is evaluated as base + x * step
+// in 16.16 fixed point; the kernels differ only in how many pixels they emit per step
+static void gradientRowScalar(unsigned char* row, unsigned width,
+                              const int32_t base[4], const int32_t step[4]) {
+    for (unsigned x = 0; x < width; x++) {
+        for (int c = 0; c < 4; c++) {
+            const int32_t value = (base[c] + static_cast<int32_t>(x) * step[c]) >> 16;
+            row[x * 4 + c] = static_cast<unsigned char>(max(0, min(255, value)));
         }
     }
 }
 
-// Helper function to add some smooth noise to make it look natural
-void addNaturalNoise(vector<unsigned char>& image, unsigned width, unsigned height, float intensity) {
-    random_device rd;
-    mt19937 rng(rd());
-    normal_distribution<float> dist(0.0f, intensity);
-    
-    const size_t totalPixels = width * height;
-    for (size_t pixel = 0; pixel < totalPixels; pixel++) {
-        size_t idx = pixel * 4;
-        // Unroll loop and combine operations
-        float noise1 = dist(rng);
-        float noise2 = dist(rng);
-        float noise3 = dist(rng);
+#ifdef ENC_DEC_X86_SIMD
+SIMD_TARGET("sse2")
+static void gradientRowSse2(unsigned char* row, unsigned width,
+                            const int32_t base[4], const int32_t step[4]) {
+    const __m128i step1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(step));
+    const __m128i step4 = _mm_slli_epi32(step1, 2);
+    __m128i acc0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base));
+    __m128i acc1 = _mm_add_epi32(acc0, step1);
+    __m128i acc2 = _mm_add_epi32(acc1, step1);
+    __m128i acc3 = _mm_add_epi32(acc2, step1);
+    
+    unsigned x = 0;
+    for (; x + 4 <= width; x += 4) {
+        const __m128i lo = _mm_packs_epi32(_mm_srai_epi32(acc0, 16), _mm_srai_epi32(acc1, 16));
+        const __m128i hi = _mm_packs_epi32(_mm_srai_epi32(acc2, 16), _mm_srai_epi32(acc3, 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x * 4), _mm_packus_epi16(lo, hi));
         
-        int newValue1 = static_cast<int>(image[idx]) + static_cast<int>(noise1);
-        int newValue2 = static_cast<int>(image[idx + 1]) + static_cast<int>(noise2);
-        int newValue3 = static_cast<int>(image[idx + 2]) + static_cast<int>(noise3);
+        acc0 = _mm_add_epi32(acc0, step4);
+        acc1 = _mm_add_epi32(acc1, step4);
+        acc2 = _mm_add_epi32(acc2, step4);
+        acc3 = _mm_add_epi32(acc3, step4);
+    }
+    
+    if (x < width) {
+        int32_t tailBase[4];
+        for (int c = 0; c < 4; c++) {
+            tailBase[c] = base[c] + static_cast<int32_t>(x) * step[c];
+        }
+        gradientRowScalar(row + x * 4, width - x, tailBase, step);
+    }
+}
+
+SIMD_TARGET("avx2")
+static void gradientRowAvx2(unsigned char* row, unsigned width,
+                            const int32_t base[4], const int32_t step[4]) {
+    // Each register holds two consecutive pixels: [x, x+1], [x+2, x+3], ...
+    const __m128i step1x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(step));
+    const __m128i base1x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(base));
+    const __m256i step2 = _mm256_broadcastsi128_si256(_mm_slli_epi32(step1x, 1));
+    const __m256i step8 = _mm256_slli_epi32(step2, 2);
+    __m256i acc0 = _mm256_inserti128_si256(_mm256_castsi128_si256(base1x),
+                                           _mm_add_epi32(base1x, step1x), 1);
+    __m256i acc1 = _mm256_add_epi32(acc0, step2);
+    __m256i acc2 = _mm256_add_epi32(acc1, step2);
+    __m256i acc3 = _mm256_add_epi32(acc2, step2);
+    
+    // The in-lane packs leave pixels ordered 0,2,4,6 | 1,3,5,7
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m256i lo = _mm256_packs_epi32(_mm256_srai_epi32(acc0, 16), _mm256_srai_epi32(acc1, 16));
+        const __m256i hi = _mm256_packs_epi32(_mm256_srai_epi32(acc2, 16), _mm256_srai_epi32(acc3, 16));
+        const __m256i pixels = _mm256_permutevar8x32_epi32(_mm256_packus_epi16(lo, hi), order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + x * 4), pixels);
         
-        image[idx] = static_cast<unsigned char>(max(0, min(255, newValue1)));
-        image[idx + 1] = static_cast<unsigned char>(max(0, min(255, newValue2)));
-        image[idx + 2] = static_cast<unsigned char>(max(0, min(255, newValue3)));
+        acc0 = _mm256_add_epi32(acc0, step8);
+        acc1 = _mm256_add_epi32(acc1, step8);
+        acc2 = _mm256_add_epi32(acc2, step8);
+        acc3 = _mm256_add_epi32(acc3, step8);
+    }
+    
+    if (x < width) {
+        int32_t tailBase[4];
+        for (int c = 0; c < 4; c++) {
+            tailBase[c] = base[c] + static_cast<int32_t>(x) * step[c];
+        }
+        gradientRowScalar(row + x * 4, width - x, tailBase, step);
     }
 }
+#endif
 
-// Helper function to add simple shapes for natural look
-void addShapes(vector<unsigned char>& image, unsigned width, unsigned height, int numShapes, mt19937& rng) {
-    uniform_int_distribution<int> xDist(0, width - 1);
-    uniform_int_distribution<int> yDist(0, height - 1);
-    uniform_int_distribution<int> radiusDist(30, 150);
-    uniform_int_distribution<int> colorDist(0, 255);
-    uniform_real_distribution<float> opacityDist(0.1f, 0.3f);
+typedef void (*GradientRowKernel)(unsigned char*, unsigned, const int32_t*, const int32_t*);
+
+static GradientRowKernel selectGradientRowKernel() {
+#ifdef ENC_DEC_X86_SIMD
+    if (cpuFeatures().avx2) return gradientRowAvx2;
+    if (cpuFeatures().sse2) return gradientRowSse2;
+#endif
+    return gradientRowScalar;
+}
+
+// Fills rows [rowBegin, rowEnd) of the gradient
+static void gradientRows(unsigned char* image, unsigned width, unsigned height,
+                         unsigned rowBegin, unsigned rowEnd,
+                         const unsigned char color1[3], const unsigned char color2[3]) {
+    static const GradientRowKernel kernel = selectGradientRowKernel();
+    
+    // blend = (x / width + y / height) / 2; the y term is folded into each row's base
+    int32_t step[4] = {0, 0, 0, 0};
+    int32_t diff[3];
+    for (int c = 0; c < 3; c++) {
+        diff[c] = static_cast<int32_t>(color2[c]) - static_cast<int32_t>(color1[c]);
+        step[c] = static_cast<int32_t>(static_cast<int64_t>(diff[c]) * 32768 / width);
+    }
     
-    for (int s = 0; s < numShapes; s++) {
-        const int centerX = xDist(rng);
-        const int centerY = yDist(rng);
-        const int radius = radiusDist(rng);
-        const unsigned char shapeColor[3] = {
-            static_cast<unsigned char>(colorDist(rng)),
-            static_cast<unsigned char>(colorDist(rng)),
-            static_cast<unsigned char>(colorDist(rng))
-        };
-        const float opacity = opacityDist(rng);
+    for (unsigned y = rowBegin; y < rowEnd; y++) {
+        int32_t base[4];
+        for (int c = 0; c < 3; c++) {
+            base[c] = (static_cast<int32_t>(color1[c]) << 16) + 0x8000 +
+                      static_cast<int32_t>(static_cast<int64_t>(diff[c]) * y * 32768 / height);
+        }
+        base[3] = 255 << 16; // Alpha channel
         
-        const int minY = max(0, centerY - radius);
-        const int maxY = min(static_cast<int>(height), centerY + radius);
-        const int minX = max(0, centerX - radius);
-        const int maxX = min(static_cast<int>(width), centerX + radius);
-        const float radiusSquared = static_cast<float>(radius * radius);
+        kernel(image + static_cast<size_t>(y) * width * 4, width, base, step);
+    }
+}
+
+// Noise samples are drawn from a quantile table instead of std::normal_distribution:
+// entry j holds the integer that trunc(N(0, intensity)) takes at probability (j + 0.5) / size,
+// which is exactly what the old float path added to each channel. Magnitudes are split
+// into positive and negative parts so they can be applied with saturating byte adds.
+const unsigned NOISE_TABLE_BITS = 12;
+const size_t NOISE_TABLE_SIZE = static_cast<size_t>(1) << NOISE_TABLE_BITS;
+const size_t NOISE_CHUNK_PIXELS = 256;
+
+struct NoiseTable {
+    unsigned char positive[NOISE_TABLE_SIZE];
+    unsigned char negative[NOISE_TABLE_SIZE];
+};
+
+static void buildNoiseTable(NoiseTable& table, float intensity) {
+    // P(trunc(X) <= k): truncation toward zero folds (-1, 1) into 0
+    auto truncatedCdf = [intensity](int k) {
+        const double edge = k >= 0 ? k + 1.0 : static_cast<double>(k);
+        return 0.5 * erfc(-edge / (intensity * sqrt(2.0)));
+    };
+    
+    int k = -255;
+    for (size_t j = 0; j < NOISE_TABLE_SIZE; j++) {
+        const double target = (j + 0.5) / NOISE_TABLE_SIZE;
+        while (intensity > 0.0f && k < 255 && truncatedCdf(k) < target) {
+            k++;
+        }
+        const int value = intensity > 0.0f ? k : 0;
+        table.positive[j] = static_cast<unsigned char>(max(0, value));
+        table.negative[j] = static_cast<unsigned char>(max(0, -value));
+    }
+}
+
+// Saturating kernels: pixel = (pixel +sat positive) -sat negative; only one of the two is non-zero
+static void applyNoiseScalar(unsigned char* pixels, const unsigned char* positive,
+                             const unsigned char* negative, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        const int value = static_cast<int>(pixels[i]) + positive[i] - negative[i];
+        pixels[i] = static_cast<unsigned char>(max(0, min(255, value)));
+    }
+}
+
+#ifdef ENC_DEC_X86_SIMD
+SIMD_TARGET("sse2")
+static void applyNoiseSse2(unsigned char* pixels, const unsigned char* positive,
+                           const unsigned char* negative, size_t bytes) {
+    size_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+        value = _mm_adds_epu8(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(positive + i)));
+        value = _mm_subs_epu8(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(negative + i)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i), value);
+    }
+    applyNoiseScalar(pixels + i, positive + i, negative + i, bytes - i);
+}
+
+SIMD_TARGET("avx2")
+static void applyNoiseAvx2(unsigned char* pixels, const unsigned char* positive,
+                           const unsigned char* negative, size_t bytes) {
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels + i));
+        value = _mm256_adds_epu8(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(positive + i)));
+        value = _mm256_subs_epu8(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(negative + i)));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels + i), value);
+    }
+    applyNoiseScalar(pixels + i, positive + i, negative + i, bytes - i);
+}
+#endif
+
+typedef void (*NoiseKernel)(unsigned char*, const unsigned char*, const unsigned char*, size_t);
+
+static NoiseKernel selectNoiseKernel() {
+#ifdef ENC_DEC_X86_SIMD
+    if (cpuFeatures().avx2) return applyNoiseAvx2;
+    if (cpuFeatures().sse2) return applyNoiseSse2;
+#endif
+    return applyNoiseScalar;
+}
+
+// Adds table-driven noise to the RGB channels of pixelCount RGBA pixels, leaving alpha alone
+static void applyNaturalNoise(unsigned char* pixels, size_t pixelCount,
+                              const NoiseTable& table, Xoshiro256& rng) {
+    static const NoiseKernel kernel = selectNoiseKernel();
+    const uint64_t indexMask = NOISE_TABLE_SIZE - 1;
+    const int samplesPerDraw = 64 / NOISE_TABLE_BITS;
+    
+    unsigned char positive[NOISE_CHUNK_PIXELS * 4];
+    unsigned char negative[NOISE_CHUNK_PIXELS * 4];
+    uint64_t bits = 0;
+    int available = 0;
+    
+    for (size_t first = 0; first < pixelCount; first += NOISE_CHUNK_PIXELS) {
+        const size_t count = min(NOISE_CHUNK_PIXELS, pixelCount - first);
         
-        for (int y = minY; y < maxY; y++) {
-            const int dy = y - centerY;
-            const int dySquared = dy * dy;
-            const size_t rowOffset = y * width * 4;
-            
-            for (int x = minX; x < maxX; x++) {
-                const int dx = x - centerX;
-                const float distanceSquared = static_cast<float>(dx * dx + dySquared);
-                
-                if (distanceSquared < radiusSquared) {
-                    const float distance = sqrt(distanceSquared);
-                    float factor = 1.0f - (distance / radius);
-                    factor = factor * factor * opacity; // Squared factor times opacity
-                    const float oneMinusFactor = 1.0f - factor;
-                    
-                    const size_t idx = rowOffset + x * 4;
-                    // Unroll loop for RGB channels
-                    image[idx] = static_cast<unsigned char>(
-                        image[idx] * oneMinusFactor + shapeColor[0] * factor);
-                    image[idx + 1] = static_cast<unsigned char>(
-                        image[idx + 1] * oneMinusFactor + shapeColor[1] * factor);
-                    image[idx + 2] = static_cast<unsigned char>(
-                        image[idx + 2] * oneMinusFactor + shapeColor[2] * factor);
+        for (size_t p = 0; p < count; p++) {
+            for (int c = 0; c < 3; c++) {
+                if (available == 0) {
+                    bits = rng();
+                    available = samplesPerDraw;
                 }
+                const size_t index = static_cast<size_t>(bits & indexMask);
+                bits >>= NOISE_TABLE_BITS;
+                available--;
+                
+                positive[p * 4 + c] = table.positive[index];
+                negative[p * 4 + c] = table.negative[index];
             }
+            positive[p * 4 + 3] = 0;
+            negative[p * 4 + 3] = 0;
         }
+        
+        kernel(pixels + first * 4, positive, negative, count * 4);
     }
 }
 
-void encryptPassword(const string& password) {
-    const unsigned width = 720;
-    const unsigned height = 720;
-    const unsigned totalPixels = width * height;
-    
-    vector<unsigned char> image;
-    image.resize(totalPixels * 4);
-    
-    // Create a random seed for the image generation
-    random_device rd;
-    mt19937 rng(rd());
+// Circles fade as (1 - d / r)^2 from the center. The falloff is tabulated over
+// t = d^2 / r^2 so rasterizing needs neither sqrt nor a divide per pixel.
+const unsigned FALLOFF_TABLE_BITS = 12;
+const size_t FALLOFF_TABLE_SIZE = static_cast<size_t>(1) << FALLOFF_TABLE_BITS;
+
+struct Circle {
+    int centerX;
+    int centerY;
+    int radius;
+    unsigned char color[3];
+    uint32_t opacityQ15;
+};
+
+static const uint16_t* falloffTable() {
+    static uint16_t table[FALLOFF_TABLE_SIZE];
+    static bool initialized = [] {
+        for (size_t i = 0; i < FALLOFF_TABLE_SIZE; i++) {
+            const double factor = 1.0 - sqrt((i + 0.5) / FALLOFF_TABLE_SIZE);
+            table[i] = static_cast<uint16_t>(factor * factor * 32767.0 + 0.5);
+        }
+        return true;
+    }();
+    (void)initialized;
+    return table;
+}
+
+// Blend kernels: pixel = (pixel * (256 - w) + color * w) >> 8 on RGB, alpha untouched
+static void blendSpanScalar(unsigned char* pixels, const uint16_t* weights, unsigned count,
+                            const unsigned char color[3]) {
+    for (unsigned i = 0; i < count; i++) {
+        const unsigned w = weights[i];
+        for (int c = 0; c < 3; c++) {
+            pixels[i * 4 + c] = static_cast<unsigned char>((pixels[i * 4 + c] * (256 - w) + color[c] * w) >> 8);
+        }
+    }
+}
+
+#ifdef ENC_DEC_X86_SIMD
+SIMD_TARGET("sse2")
+static void blendSpanSse2(unsigned char* pixels, const uint16_t* weights, unsigned count,
+                          const unsigned char color[3]) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(256);
+    const __m128i rgbMask = _mm_setr_epi16(-1, -1, -1, 0, -1, -1, -1, 0);
+    const __m128i colorWide = _mm_setr_epi16(color[0], color[1], color[2], 0,
+                                             color[0], color[1], color[2], 0);
+    
+    unsigned i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128i packed = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i * 4));
+        
+        // Broadcast each pixel's weight to its RGB lanes; alpha gets weight 0
+        const __m128i w01 = _mm_and_si128(_mm_setr_epi16(weights[i], weights[i], weights[i], 0,
+                                                         weights[i + 1], weights[i + 1], weights[i + 1], 0), rgbMask);
+        const __m128i w23 = _mm_and_si128(_mm_setr_epi16(weights[i + 2], weights[i + 2], weights[i + 2], 0,
+                                                         weights[i + 3], weights[i + 3], weights[i + 3], 0), rgbMask);
+        
+        __m128i lo = _mm_unpacklo_epi8(packed, zero);
+        __m128i hi = _mm_unpackhi_epi8(packed, zero);
+        lo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(lo, _mm_sub_epi16(full, w01)),
+                                          _mm_mullo_epi16(colorWide, w01)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(hi, _mm_sub_epi16(full, w23)),
+                                          _mm_mullo_epi16(colorWide, w23)), 8);
+        
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i * 4), _mm_packus_epi16(lo, hi));
+    }
     
-    // Generate natural looking colors for the gradient
+    blendSpanScalar(pixels + i * 4, weights + i, count - i, color);
+}
+#endif
+
+typedef void (*BlendSpanKernel)(unsigned char*, const uint16_t*, unsigned, const unsigned char*);
+
+static BlendSpanKernel selectBlendSpanKernel() {
+#ifdef ENC_DEC_X86_SIMD
+    if (cpuFeatures().sse2) return blendSpanSse2;
+#endif
+    return blendSpanScalar;
+}
+
+// Integer square root: largest s with s * s <= value
+static int isqrt(int value) {
+    int root = static_cast<int>(sqrt(static_cast<double>(value)));
+    while (root * root > value) root--;
+    while ((root + 1) * (root + 1) <= value) root++;
+    return root;
+}
+
+// Rasterizes the rows [rowBegin, rowEnd) of one circle. Each row's covered span is
+// solved analytically from dx^2 + dy^2 < r^2, then weighted and blended as a whole.
+static void rasterizeCircle(unsigned char* image, unsigned width, int rowBegin, int rowEnd,
+                            const Circle& circle, uint16_t* weights) {
+    static const BlendSpanKernel blendSpan = selectBlendSpanKernel();
+    const uint16_t* falloff = falloffTable();
+    
+    const int radius = circle.radius;
+    const int radiusSquared = radius * radius;
+    const uint32_t indexScale = (static_cast<uint32_t>(FALLOFF_TABLE_SIZE) << 16) / radiusSquared;
+    
+    const int minY = max(rowBegin, circle.centerY - radius);
+    const int maxY = min(rowEnd, circle.centerY + radius);
+    
+    for (int y = minY; y < maxY; y++) {
+        const int dy = y - circle.centerY;
+        const int remaining = radiusSquared - dy * dy;
+        if (remaining <= 0) {
+            continue;
+        }
+        
+        const int halfSpan = isqrt(remaining - 1);
+        const int spanBegin = max(0, circle.centerX - halfSpan);
+        const int spanEnd = min(static_cast<int>(width), circle.centerX + halfSpan + 1);
+        if (spanBegin >= spanEnd) {
+            continue;
+        }
+        
+        // d^2 advances by 2 * dx + 1 per pixel, so no multiply is needed in the loop
+        int dx = spanBegin - circle.centerX;
+        uint32_t distanceSquared = static_cast<uint32_t>(dx * dx + dy * dy);
+        for (int x = spanBegin; x < spanEnd; x++, dx++) {
+            const uint32_t index = (distanceSquared * indexScale) >> 16;
+            weights[x - spanBegin] = static_cast<uint16_t>(
+                (falloff[index] * circle.opacityQ15 + (1u << 21)) >> 22);
+            distanceSquared += 2 * dx + 1;
+        }
+        
+        unsigned char* row = image + (static_cast<size_t>(y) * width + spanBegin) * 4;
+        blendSpan(row, weights, static_cast<unsigned>(spanEnd - spanBegin), circle.color);
+    }
+}
+
+template <typename Rng>
+static Circle randomCircle(Rng& rng, unsigned width, unsigned height) {
+    uniform_int_distribution<int> xDist(0, width - 1);
+    uniform_int_distribution<int> yDist(0, height - 1);
+    uniform_int_distribution<int> radiusDist(30, 150);
     uniform_int_distribution<int> colorDist(0, 255);
-    vector<unsigned char> color1 = {
-        static_cast<unsigned char>(colorDist(rng)),
-        static_cast<unsigned char>(colorDist(rng)),
-        static_cast<unsigned char>(colorDist(rng))
-    };
-    
-    vector<unsigned char> color2 = {
-        static_cast<unsigned char>(colorDist(rng)),
-        static_cast<unsigned char>(colorDist(rng)),
-        static_cast<unsigned char>(colorDist(rng))
-    };
+    uniform_real_distribution<float> opacityDist(0.1f, 0.3f);
     
-    // Create gradient background
-    generateGradient(image, width, height, color1, color2);
+    Circle circle;
+    circle.centerX = xDist(rng);
+    circle.centerY = yDist(rng);
+    circle.radius = radiusDist(rng);
+    for (int c = 0; c < 3; c++) {
+        circle.color[c] = static_cast<unsigned char>(colorDist(rng));
+    }
+    circle.opacityQ15 = static_cast<uint32_t>(opacityDist(rng) * 32768.0f + 0.5f);
+    return circle;
+}
+
+// Generates a complete cover in one pass per row band: gradient, shapes and noise are
+// applied while the band is still in cache. Bands are independent (each has its own
+// noise stream derived from the seed), so they are spread across threads and the
+// output is identical for any thread count.
+void generateCoverImage(vector<unsigned char>& image, unsigned width, unsigned height,
+                        uint64_t seed, unsigned threads) {
+    image.resize(static_cast<size_t>(width) * height * 4);
+    
+    // Scene parameters come from a single stream so the whole layout is fixed up front
+    Xoshiro256 sceneRng(seed);
+    uniform_int_distribution<int> colorDist(0, 255);
+    unsigned char color1[3], color2[3];
+    for (int c = 0; c < 3; c++) {
+        color1[c] = static_cast<unsigned char>(colorDist(sceneRng));
+    }
+    for (int c = 0; c < 3; c++) {
+        color2[c] = static_cast<unsigned char>(colorDist(sceneRng));
+    }
     
-    // Add some shapes to make it look more like a photograph
     uniform_int_distribution<int> numShapesDist(10, 25);
-    int numShapes = numShapesDist(rng);
-    addShapes(image, width, height, numShapes, rng);
-    
-    // Add subtle noise to make it look more natural
-    addNaturalNoise(image, width, height, 10.0f);
-    
-    // Continue with encryption as before
-    string salt = generateRandomString(16);
-    string key = pbkdf2(salt, salt, AES_KEY_SIZE, PBKDF2_ITERATIONS);
-    
-    vector<unsigned char> iv(AES_BLOCK_SIZE);
-    RAND_bytes(iv.data(), AES_BLOCK_SIZE);
+    vector<Circle> circles(numShapesDist(sceneRng));
+    for (auto& circle : circles) {
+        circle = randomCircle(sceneRng, width, height);
+    }
     
-    string passwordHash = sha256(password);
+    NoiseTable noise;
+    buildNoiseTable(noise, COVER_NOISE_INTENSITY);
+    const uint64_t noiseSeed = sceneRng();
     
-    vector<unsigned char> encryptedData = aesEncrypt(password, key, iv);
+    const unsigned bandCount = (height + COVER_BAND_ROWS - 1) / COVER_BAND_ROWS;
+    if (threads == 0) {
+        threads = thread::hardware_concurrency();
+    }
+    threads = max(1u, min(threads, bandCount));
     
-    // Store the encryption metadata in the image
-    const unsigned encLen = encryptedData.size();
-    const unsigned char encLenBytes[4] = {
-        static_cast<unsigned char>((encLen) & 0xFF),
-        static_cast<unsigned char>((encLen >> 8) & 0xFF),
-        static_cast<unsigned char>((encLen >> 16) & 0xFF),
-        static_cast<unsigned char>((encLen >> 24) & 0xFF)
+    atomic<unsigned> nextBand(0);
+    auto worker = [&]() {
+        vector<uint16_t> weights(width);
+        
+        for (unsigned band = nextBand++; band < bandCount; band = nextBand++) {
+            const unsigned rowBegin = band * COVER_BAND_ROWS;
+            const unsigned rowEnd = min(height, rowBegin + COVER_BAND_ROWS);
+            unsigned char* rows = image.data() + static_cast<size_t>(rowBegin) * width * 4;
+            
+            gradientRows(image.data(), width, height, rowBegin, rowEnd, color1, color2);
+            
+            for (const auto& circle : circles) {
+                rasterizeCircle(image.data(), width, static_cast<int>(rowBegin), static_cast<int>(rowEnd),
+                                circle, weights.data());
+            }
+            
+            Xoshiro256 bandRng(noiseSeed ^ (static_cast<uint64_t>(band) * 0x9e3779b97f4a7c15ULL));
+            applyNaturalNoise(rows, static_cast<size_t>(rowEnd - rowBegin) * width, noise, bandRng);
+        }
     };
     
-    // Store encryption length at three locations (combined loop)
-    for (int i = 0; i < 4; i++) {
-        image[i] = encLenBytes[i];
-        image[width*4 - 4 + i] = encLenBytes[i];
-        image[width*8 + i] = encLenBytes[i];
+    vector<thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; t++) {
+        pool.emplace_back(worker);
     }
+    worker();
     
-    // Store salt at two locations (combined loop)
-    for (size_t i = 0; i < salt.length(); i++) {
-        const unsigned char saltChar = static_cast<unsigned char>(salt[i]);
-        image[20 + i] = saltChar;
-        image[width * 4 - 20 - i] = saltChar;
+    for (auto& t : pool) {
+        t.join();
+    }
+}
+
+// Cache entries are keyed by salt and KDF settings, so an image reusing a salt
+// with other parameters is never served a key derived for different ones
+static string keyCacheId(const string& salt, const KdfSettings& kdf) {
+    string id = salt;
+    id.push_back(static_cast<char>(kdf.algorithm));
+    for (uint32_t param : kdf.params) {
+        for (int i = 0; i < 4; i++) {
+            id.push_back(static_cast<char>((param >> (i * 8)) & 0xFF));
+        }
+    }
+    return id;
+}
+
+bool deriveImageKey(const string& salt, const KdfSettings& kdf, string& key, unsigned& seed) {
+    // The salt doubles as the password, not mixing the program password for decryption.
+    // Re-reading the same image hits the key cache instead of rerunning the KDF.
+    const string cacheId = keyCacheId(salt, kdf);
+    if (KeyCache::instance().lookup(cacheId, key, seed)) {
+        return true;
     }
     
-    // Store IV at three locations (combined loop)
-    for (int i = 0; i < AES_BLOCK_SIZE; i++) {
-        const unsigned char ivByte = iv[i];
-        image[100 + i] = ivByte;
-        image[width * 4 - 100 - i] = ivByte;
-        image[(height/2 * width + width/2) * 4 + i] = ivByte;
+    key = deriveKdfKey(kdf, salt, salt, AES_KEY_SIZE);
+    if (key.empty()) {
+        return false;
     }
     
-    // Store password hash at two locations (combined loop)
-    const size_t hashLen = min(static_cast<size_t>(32), passwordHash.length());
-    for (size_t i = 0; i < hashLen; i++) {
-        const unsigned char hashChar = static_cast<unsigned char>(passwordHash[i]);
-        image[200 + i] = hashChar;
-        image[totalPixels * 4 - 200 - i] = hashChar;
+    // Derive the seed from key and salt instead of reading it from the image
+    seed = deriveSeedFromKey(key, salt);
+    KeyCache::instance().insert(cacheId, key, seed);
+    return true;
+}
+
+// Builds, embeds and writes the image for one password whose key is already derived from salt;
+// threads bounds the cover synthesis (0 = one per core)
+static string encryptWithKey(const string& password, const string& salt, const KdfSettings& kdf, const string& key,
+                             const string& outDir, unsigned threads) {
+    const unsigned width = COVER_WIDTH;
+    const unsigned height = COVER_HEIGHT;
+    const unsigned totalPixels = width * height;
+    
+    // Reuse the cover buffer across calls so batch runs allocate it once
+    static thread_local vector<unsigned char> image;
+    image.resize(totalPixels * 4);
+    
+    // Seed the cover synthesis from the CSPRNG pool
+    uint64_t coverSeed;
+    if (!randomSeed(coverSeed)) {
+        return "";
     }
+    generateCoverImage(image, width, height, coverSeed, threads);
     
-    // Create indices for embedding encrypted data
-    vector<size_t> indices;
-    indices.reserve(totalPixels / 2);
+    const unsigned char cipher = DEFAULT_CIPHER;
+    vector<unsigned char> iv(cipherIvSize(cipher));
+    if (!randomBytes(iv.data(), iv.size())) {
+        return "";
+    }
     
-    const size_t imageSize = totalPixels * 4;
-    for (size_t idx = DATA_EMBEDDING_START; idx < imageSize - METADATA_BOUNDARY; idx += 4) {
-        indices.push_back(idx);
+    string passwordHash = sha256(password);
+    
+    // One pass for AES-GCM; CBC adds an HMAC over the ciphertext
+    vector<unsigned char> encryptedData;
+    vector<unsigned char> tag;
+    if (!sealData(cipher, password, key, iv, "", encryptedData, tag)) {
+        cerr << "Error: Encryption failed." << endl;
+        return "";
     }
+    const unsigned encLen = encryptedData.size();
     
+    // Map data slots to pixel offsets with a keyed permutation
+    const size_t imageSize = totalPixels * 4;
     unsigned seed = deriveSeedFromKey(key, salt);
-    mt19937 g(seed);
-    shuffle(indices.begin(), indices.end(), g);
-    
-    // Embed encrypted data with redundancy (combined loop)
-    const size_t indicesThird = indices.size() / 3;
-    const size_t encDataSize = encryptedData.size();
-    for (size_t i = 0; i < encDataSize && i < indices.size(); i++) {
-        const unsigned char dataByte = encryptedData[i];
-        image[indices[i]] = dataByte;
+    const IndexPermutation slots(dataSlotCount(imageSize), seed);
+    
+    // Embed the ciphertext through the payload codec
+    if (PAYLOAD_CODEC == PAYLOAD_CODEC_REED_SOLOMON) {
+        const ReedSolomon rs(PAYLOAD_PARITY);
+        const size_t parityLen = rs.parityLength(encLen);
+        if (encLen + parityLen > slots.size()) {
+            cerr << "Error: Password is too long for the cover image." << endl;
+            return "";
+        }
         
-        if (i + indicesThird < indices.size()) {
-            image[indices[i + indicesThird]] = dataByte;
+        vector<unsigned char> parity(parityLen);
+        rs.encode(encryptedData.data(), encLen, parity.data());
+        for (size_t i = 0; i < encLen; i++) {
+            image[slotOffset(slots(i))] = encryptedData[i];
+        }
+        for (size_t i = 0; i < parityLen; i++) {
+            image[slotOffset(slots(encLen + i))] = parity[i];
+        }
+    } else {
+        // DATA_COPIES copies of the ciphertext, copy c starting at slot c * copyStride
+        const size_t copyStride = slots.size() / (DATA_COPIES + 1);
+        if (encLen > copyStride) {
+            cerr << "Error: Password is too long for the cover image." << endl;
+            return "";
+        }
+        for (size_t c = 0; c < DATA_COPIES; c++) {
+            for (size_t i = 0; i < encLen; i++) {
+                image[slotOffset(slots(c * copyStride + i))] = encryptedData[i];
+            }
         }
     }
     
-    vector<unsigned char> hmac = generateHMAC(encryptedData, key);
-    
-    // Store HMAC at three locations (combined loop)
-    const size_t hmacSize = min(hmac.size(), static_cast<size_t>(HMAC_SIZE));
-    for (size_t i = 0; i < hmacSize; i++) {
-        const unsigned char hmacByte = hmac[i];
-        image[imageSize - 40 - i] = hmacByte;
-        image[imageSize - 40 - HMAC_SIZE - i] = hmacByte;
-        image[400 + i] = hmacByte;
+    // Everything needed to decrypt goes into the protected header at the start of the image
+    ImageHeader header = ImageHeader();
+    header.version = HEADER_VERSION;
+    header.layout = IMAGE_LAYOUT_SINGLE;
+    header.codec = PAYLOAD_CODEC;
+    header.payloadParity = static_cast<unsigned char>(PAYLOAD_PARITY);
+    header.kdf = kdf;
+    header.cipher = cipher;
+    header.payloadLength = encLen;
+    memcpy(header.salt, salt.data(), HEADER_SALT_SIZE);
+    memcpy(header.iv, iv.data(), iv.size());
+    memcpy(header.authTag, tag.data(), min(tag.size(), cipherTagSize(cipher)));
+    memcpy(header.passwordHash, passwordHash.data(), HEADER_HASH_SIZE);
+    writeImageHeader(header, image.data());
+    
+    const string name = generateRandomString(10);
+    if (name.empty()) {
+        return "";
+    }
+    string filename = "enc_" + name + ".png";
+    if (!outDir.empty()) {
+        const char last = outDir[outDir.length() - 1];
+        filename = outDir + ((last == '/' || last == '\\') ? "" : "/") + filename;
     }
     
-    string filename = "enc_" + generateRandomString(10) + ".png";
-    
-    unsigned error = lodepng::encode(filename, image, width, height);
+    unsigned error = encodePng(filename, image, width, height);
     if (error) {
-        cout << "Error encoding image: " << lodepng_error_text(error) << endl;
-    } else {
-        cout << "Password encrypted to file: " << filename << endl;
+        cerr << "Error encoding image: " << lodepng_error_text(error) << endl;
+        return "";
     }
+    
+    return filename;
 }
 
-string decryptPassword(const string& filename) {
-    vector<unsigned char> image;
-    unsigned width, height;
-    
-    unsigned error = lodepng::decode(image, width, height, filename);
-    if (error) {
-        cout << "Error decoding image: " << lodepng_error_text(error) << endl;
+string encryptPassword(const string& password, const string& outDir) {
+    const KdfSettings kdf = kdfSettings();
+    const string salt = generateRandomString(HEADER_SALT_SIZE);
+    const string key = salt.empty() ? "" : deriveKdfKey(kdf, salt, salt, AES_KEY_SIZE);
+    if (key.empty()) {
         return "";
     }
-    
-    const unsigned totalPixels = width * height;
-    const size_t imageSize = totalPixels * 4;
-    
-    // Extract encryption length from three locations (combined loop)
-    unsigned encLen1 = 0, encLen2 = 0, encLen3 = 0;
-    for (int i = 0; i < 4; i++) {
-        const unsigned shift = i * 8;
-        encLen1 |= (static_cast<unsigned>(image[i]) << shift);
-        encLen2 |= (static_cast<unsigned>(image[width*4 - 4 + i]) << shift);
-        encLen3 |= (static_cast<unsigned>(image[width*8 + i]) << shift);
+    return encryptWithKey(password, salt, kdf, key, outDir, 0);
+}
+
+vector<string> encryptPasswords(const vector<string>& passwords, const string& outDir, unsigned threads) {
+    // Keys are derived up front, PBKDF2 ones in one multi-buffer batch and memory-hard
+    // ones on the worker pool; then the images are built one by one
+    const KdfSettings kdf = kdfSettings();
+    vector<string> salts(passwords.size());
+    for (auto& salt : salts) {
+        salt = generateRandomString(HEADER_SALT_SIZE);
     }
     
-    unsigned encLen;
-    if (encLen1 == encLen2 || encLen1 == encLen3) {
-        encLen = encLen1;
-    } else if (encLen2 == encLen3) {
-        encLen = encLen2;
-    } else {
-        vector<unsigned> lens = {encLen1, encLen2, encLen3};
-        sort(lens.begin(), lens.end());
-        encLen = lens[1];
-        
-        if (encLen > 10000) {
-            encLen = min({encLen1, encLen2, encLen3});
-            if (encLen > 10000) encLen = 1000;
+    vector<string> keys(passwords.size());
+    if (kdf.algorithm == KDF_PBKDF2_SHA256) {
+        vector<Pbkdf2Job> jobs(passwords.size());
+        for (size_t i = 0; i < passwords.size(); i++) {
+            jobs[i] = Pbkdf2Job{salts[i], salts[i], kdf.params[0]};
         }
+        keys = pbkdf2Batch(jobs, AES_KEY_SIZE, threads);
+    } else {
+        runWorkers(passwords.size(), threads, [&](size_t i) {
+            keys[i] = deriveKdfKey(kdf, salts[i], salts[i], AES_KEY_SIZE);
+        });
     }
     
-    if (encLen1 != encLen2 || encLen2 != encLen3) {
-        cout << "Warning: Size data was corrupted but recovered using redundancy." << endl;
-    }
-    
-    // Extract salt from two locations with error recovery (combined loop)
-    string salt;
-    salt.reserve(16);
-    bool saltCorrupted = false;
-    
-    for (size_t i = 0; i < 16; i++) {
-        unsigned char salt1 = image[20 + i];
-        unsigned char salt2 = image[width * 4 - 20 - i];
-        
-        if (salt1 == salt2) {
-            salt.push_back(salt1);
-        } else {
-            saltCorrupted = true;
-            salt.push_back((salt1 != 0) ? salt1 : salt2);
+    vector<string> filenames(passwords.size());
+    for (size_t i = 0; i < passwords.size(); i++) {
+        if (salts[i].empty() || keys[i].empty()) {
+            cerr << "Error: Key derivation failed." << endl;
+            continue;
         }
+        filenames[i] = encryptWithKey(passwords[i], salts[i], kdf, keys[i], outDir, threads);
     }
-    
-    if (saltCorrupted) {
-        cout << "Warning: Salt was corrupted but attempted recovery." << endl;
+    return filenames;
+}
+
+// Opens an image and parses its header. The PNG is streamed instead of decoded
+// whole: the header lives in the first row, the payload is gathered later.
+static bool openPasswordImage(const string& filename, SparsePngReader& reader, ImageHeader& header) {
+    unsigned error = reader.open(filename);
+    if (!error) {
+        error = reader.retainRows(METADATA_ROWS);
     }
-    
-    // Extract IV from three locations with error recovery (combined loop)
-    vector<unsigned char> iv(AES_BLOCK_SIZE);
-    bool ivCorrupted = false;
-    
-    for (int i = 0; i < AES_BLOCK_SIZE; i++) {
-        unsigned char iv1 = image[100 + i];
-        unsigned char iv2 = image[width * 4 - 100 - i];
-        unsigned char iv3 = image[(height/2 * width + width/2) * 4 + i];
-        
-        if (iv1 == iv2 || iv1 == iv3) {
-            iv[i] = iv1;
-        } else if (iv2 == iv3) {
-            iv[i] = iv2;
-        } else {
-            ivCorrupted = true;
-            iv[i] = (iv1 != 0) ? iv1 : ((iv2 != 0) ? iv2 : iv3);
-        }
+    if (error) {
+        cerr << "Error decoding image: " << lodepng_error_text(error) << endl;
+        return false;
     }
     
-    if (ivCorrupted) {
-        cout << "Warning: IV was corrupted but repaired using redundant data." << endl;
+    const size_t imageSize = static_cast<size_t>(reader.width()) * reader.height() * 4;
+    if (imageSize < 2 * (DATA_EMBEDDING_START + METADATA_BOUNDARY)) {
+        cerr << "Error: Image is too small to hold encrypted data." << endl;
+        return false;
     }
     
-    // Create indices for extracting encrypted data (optimized)
-    vector<size_t> indices;
-    indices.reserve(totalPixels / 2);
-    
-    for (size_t idx = DATA_EMBEDDING_START; idx < imageSize - METADATA_BOUNDARY; idx += 4) {
-        indices.push_back(idx);
+    // Parse and repair the header from the retained first row
+    vector<unsigned char> headerBytes(min(reader.retainedSize(), HEADER_MAX_SIZE));
+    for (size_t i = 0; i < headerBytes.size(); i++) {
+        headerBytes[i] = reader.retainedByte(i);
     }
     
-    // Use PBKDF2 with just salt, not mixing the program password for decryption
-    string key = pbkdf2(salt, salt, AES_KEY_SIZE, PBKDF2_ITERATIONS);
-    
-    // Derive the seed from key and salt instead of reading it from the image
-    unsigned seed = deriveSeedFromKey(key, salt);
-    mt19937 g(seed);
-    shuffle(indices.begin(), indices.end(), g);
+    // Images from before the header existed keep their metadata at fixed offsets
+    if (!hasImageHeader(headerBytes.data(), headerBytes.size())) {
+        return readLegacyHeader(reader, header);
+    }
     
-    // Extract encrypted data with frequency analysis (optimized)
-    vector<map<unsigned char, int>> byteFrequencies(encLen);
-    const size_t indicesThird = indices.size() / 3;
+    size_t repaired = 0;
+    if (readImageHeader(headerBytes.data(), headerBytes.size(), header, repaired) == 0) {
+        return false;
+    }
+    if (repaired > 0) {
+        cerr << "Warning: Header was corrupted but repaired using parity (" << repaired << " bytes)." << endl;
+    }
     
-    for (size_t i = 0; i < encLen && i < indices.size(); i++) {
-        byteFrequencies[i][image[indices[i]]]++;
-        
-        if (i + indicesThird < indices.size() && i < encLen) {
-            byteFrequencies[i][image[indices[i + indicesThird]]]++;
-        }
+    if (header.layout != IMAGE_LAYOUT_SINGLE) {
+        cerr << "Error: " << filename << " is a container; use \"container get\" to read its entries." << endl;
+        return false;
+    }
+    if (header.codec != PAYLOAD_CODEC_REPETITION && header.codec != PAYLOAD_CODEC_REED_SOLOMON) {
+        cerr << "Error: Unknown payload codec " << static_cast<unsigned>(header.codec) << "." << endl;
+        return false;
+    }
+    return validateKdfSettings(header.kdf);
+}
+
+// Gathers, repairs, verifies and decrypts the payload of an opened image
+static string decryptOpenedImage(SparsePngReader& reader, const ImageHeader& header, const string& key, unsigned seed) {
+    if (header.version == LEGACY_HEADER_VERSION) {
+        return decryptLegacyImage(reader, header, key, seed);
     }
     
-    vector<unsigned char> encryptedData(encLen);
-    for (size_t i = 0; i < encLen; i++) {
-        unsigned char mostCommon = 0;
-        int maxCount = 0;
-        
-        for (const auto& pair : byteFrequencies[i]) {
-            if (pair.second > maxCount) {
-                maxCount = pair.second;
-                mostCommon = pair.first;
+    const size_t imageSize = static_cast<size_t>(reader.width()) * reader.height() * 4;
+    const unsigned char codec = header.codec;
+    const unsigned payloadParity = header.payloadParity;
+    const unsigned encLen = header.payloadLength;
+    const vector<unsigned char> iv(header.iv, header.iv + cipherIvSize(header.cipher));
+    const vector<unsigned char> storedTag(header.authTag, header.authTag + cipherTagSize(header.cipher));
+    
+    const IndexPermutation slots(dataSlotCount(imageSize), seed);
+    const ReedSolomon payloadCode(payloadParity);
+    
+    // Collect every payload offset up front so the reader makes a single forward pass
+    vector<size_t> offsets;
+    if (codec == PAYLOAD_CODEC_REED_SOLOMON) {
+        const size_t payloadSize = encLen + payloadCode.parityLength(encLen);
+        if (payloadParity == 0 || payloadSize > slots.size()) {
+            cerr << "Error: Invalid payload size." << endl;
+            return "";
+        }
+        offsets.reserve(payloadSize);
+        for (size_t i = 0; i < payloadSize; i++) {
+            offsets.push_back(slotOffset(slots(i)));
+        }
+    } else {
+        const size_t copyStride = slots.size() / (DATA_COPIES + 1);
+        if (encLen > copyStride) {
+            cerr << "Error: Invalid payload size." << endl;
+            return "";
+        }
+        offsets.reserve(DATA_COPIES * encLen);
+        for (size_t c = 0; c < DATA_COPIES; c++) {
+            for (size_t i = 0; i < encLen; i++) {
+                offsets.push_back(slotOffset(slots(c * copyStride + i)));
             }
         }
-        
-        encryptedData[i] = mostCommon;
     }
     
-    // Extract stored HMAC from multiple locations (combined into arrays)
-    vector<unsigned char> storedHmac1(HMAC_SIZE), storedHmac2(HMAC_SIZE), storedHmac3(HMAC_SIZE);
-    for (int i = 0; i < HMAC_SIZE; i++) {
-        storedHmac1[i] = image[imageSize - 40 - i];
-        storedHmac2[i] = image[imageSize - 40 - HMAC_SIZE - i];
-        storedHmac3[i] = image[400 + i];
+    vector<unsigned char> payload;
+    unsigned error = reader.gather(offsets, payload);
+    if (error) {
+        cerr << "Error decoding image: " << lodepng_error_text(error) << endl;
+        return "";
     }
     
-    // Verify with each HMAC and consider verification successful if any match
-    bool hmacVerified = 
-        verifyHMAC(encryptedData, storedHmac1, key) ||
-        verifyHMAC(encryptedData, storedHmac2, key) ||
-        verifyHMAC(encryptedData, storedHmac3, key);
+    vector<unsigned char> encryptedData(encLen);
+    if (codec == PAYLOAD_CODEC_REED_SOLOMON) {
+        size_t repaired = 0;
+        if (!payloadCode.decode(payload.data(), encLen, vector<size_t>(), &repaired)) {
+            cerr << "Warning: Encrypted data is corrupted beyond what parity can repair." << endl;
+        } else if (repaired > 0) {
+            cerr << "Warning: Encrypted data was corrupted but repaired using parity (" << repaired << " bytes)." << endl;
+        }
+        copy(payload.begin(), payload.begin() + encLen, encryptedData.begin());
+    } else {
+        // Vote the data copies byte by byte; ties pick the smallest value
+        voteBytes(payload.data(), DATA_COPIES, encLen, encryptedData.data());
+    }
     
-    if (!hmacVerified) {
-        cout << "Warning: HMAC verification failed. Data integrity cannot be guaranteed." << endl;
+    string password;
+    if (header.cipher == CIPHER_AES_256_GCM) {
+        // GCM releases no plaintext unless the tag matches
+        if (!aesGcmDecrypt(encryptedData, key, iv, "", storedTag, password)) {
+            cerr << "Error: Authentication failed. Wrong password or corrupted data." << endl;
+            return "";
+        }
+        cerr << "Authentication tag verified. Data integrity confirmed." << endl;
     } else {
-        cout << "HMAC verification successful. Data integrity confirmed." << endl;
+        bool hmacVerified = verifyHMAC(encryptedData, storedTag, key);
+        
+        if (!hmacVerified) {
+            cerr << "Warning: HMAC verification failed. Data integrity cannot be guaranteed." << endl;
+        } else {
+            cerr << "HMAC verification successful. Data integrity confirmed." << endl;
+        }
     }
     
     try {
-        string password = aesDecrypt(encryptedData, key, iv);
+        if (header.cipher != CIPHER_AES_256_GCM) {
+            password = aesDecrypt(encryptedData, key, iv);
+        }
         
         if (!password.empty()) {
             string passwordHash = sha256(password);
             int validHashes = 0;
             int totalChecks = 0;
             
-            // Verify password hash (combined loop)
-            const size_t hashLen = min(static_cast<size_t>(32), passwordHash.length());
+            // Compare against the stored hash prefix
+            const size_t hashLen = min(HEADER_HASH_SIZE, passwordHash.length());
             for (size_t i = 0; i < hashLen; i++) {
-                totalChecks += 2;
-                
-                unsigned char hash1 = image[200 + i];
-                unsigned char hash2 = image[imageSize - 200 - i];
-                
-                unsigned char expectedHash = static_cast<unsigned char>(passwordHash[i]);
-                
-                if (expectedHash == hash1) validHashes++;
-                if (expectedHash == hash2) validHashes++;
+                totalChecks++;
+                if (static_cast<unsigned char>(passwordHash[i]) == header.passwordHash[i]) validHashes++;
             }
             
             float hashValidityPercentage = (float)validHashes / totalChecks * 100.0f;
-            cout << "Password hash verification: " << hashValidityPercentage << "% valid" << endl;
+            cerr << "Password hash verification: " << hashValidityPercentage << "% valid" << endl;
             
             if (hashValidityPercentage < 30.0f) {
-                cout << "Warning: Password verification failed. The data may be corrupted." << endl;
+                cerr << "Warning: Password verification failed. The data may be corrupted." << endl;
             }
             
             return password;
         }
         return password;
     } catch (...) {
-        cout << "Error: Exception during decryption process." << endl;
+        cerr << "Error: Exception during decryption process." << endl;
         return "";
     }
 }
 
+string decryptPassword(const string& filename) {
+    SparsePngReader reader;
+    ImageHeader header;
+    if (!openPasswordImage(filename, reader, header)) {
+        return "";
+    }
+    
+    const string salt(reinterpret_cast<const char*>(header.salt), HEADER_SALT_SIZE);
+    string key;
+    unsigned seed;
+    if (!deriveImageKey(salt, header.kdf, key, seed)) {
+        cerr << "Error: Key derivation failed." << endl;
+        return "";
+    }
+    
+    return decryptOpenedImage(reader, header, key, seed);
+}
+
+vector<string> decryptPasswords(const vector<string>& filenames, unsigned threads) {
+    vector<string> results(filenames.size());
+    
+    // Chunk by chunk: open every image and read its header, derive all PBKDF2 keys
+    // the cache does not hold in one multi-buffer batch, then decrypt the payloads.
+    // Other KDFs are memory-hard and derived by the workers, one image each.
+    for (size_t first = 0; first < filenames.size(); first += PBKDF2_BATCH_CHUNK) {
+        const size_t count = min(PBKDF2_BATCH_CHUNK, filenames.size() - first);
+        vector<unique_ptr<SparsePngReader>> readers(count);
+        vector<ImageHeader> headers(count);
+        vector<char> ready(count, 0);
+        
+        runWorkers(count, threads, [&](size_t i) {
+            readers[i].reset(new SparsePngReader());
+            ready[i] = openPasswordImage(filenames[first + i], *readers[i], headers[i]);
+        });
+        
+        vector<string> keys(count);
+        vector<unsigned> seeds(count);
+        vector<Pbkdf2Job> jobs;
+        vector<size_t> jobImages;
+        for (size_t i = 0; i < count; i++) {
+            const string salt(reinterpret_cast<const char*>(headers[i].salt), HEADER_SALT_SIZE);
+            if (ready[i] && headers[i].kdf.algorithm == KDF_PBKDF2_SHA256 &&
+                !KeyCache::instance().lookup(keyCacheId(salt, headers[i].kdf), keys[i], seeds[i])) {
+                jobs.push_back(Pbkdf2Job{salt, salt, headers[i].kdf.params[0]});
+                jobImages.push_back(i);
+            }
+        }
+        
+        const vector<string> derived = pbkdf2Batch(jobs, AES_KEY_SIZE, threads);
+        for (size_t j = 0; j < jobs.size(); j++) {
+            const size_t i = jobImages[j];
+            if (derived[j].empty()) {
+                cerr << "Error: Key derivation failed." << endl;
+                ready[i] = 0;
+                continue;
+            }
+            keys[i] = derived[j];
+            seeds[i] = deriveSeedFromKey(keys[i], jobs[j].salt);
+            KeyCache::instance().insert(keyCacheId(jobs[j].salt, headers[i].kdf), keys[i], seeds[i]);
+        }
+        
+        runWorkers(count, threads, [&](size_t i) {
+            if (ready[i] && keys[i].empty()) {
+                const string salt(reinterpret_cast<const char*>(headers[i].salt), HEADER_SALT_SIZE);
+                if (!deriveImageKey(salt, headers[i].kdf, keys[i], seeds[i])) {
+                    cerr << "Error: Key derivation failed." << endl;
+                    ready[i] = 0;
+                }
+            }
+            if (ready[i]) {
+                results[first + i] = decryptOpenedImage(*readers[i], headers[i], keys[i], seeds[i]);
+            }
+            readers[i].reset();
+        });
+    }
+    
+    return results;
+}
+
 vector<string> listEncFiles() {
     vector<string> files;
     DIR* dir;
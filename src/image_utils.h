@@ -2,17 +2,44 @@
 
 #include <vector>
 #include <string>
-#include <random>
+#include <cstdint>
 #include "../Include/lodepng.h"
+#include "kdf.h"
 
 // Constants for data embedding boundaries
 const size_t METADATA_BOUNDARY = 300;
 const size_t DATA_EMBEDDING_START = 304; // METADATA_BOUNDARY + 4 bytes
+const unsigned METADATA_ROWS = 1; // Rows holding the image header
 
-void encryptPassword(const std::string& password);
+// Payload codecs; the one used is recorded in the image header
+const unsigned char PAYLOAD_CODEC_REPETITION = 0; // DATA_COPIES copies, voted byte by byte
+const unsigned char PAYLOAD_CODEC_REED_SOLOMON = 1; // one copy plus interleaved RS parity
+const unsigned char PAYLOAD_CODEC = PAYLOAD_CODEC_REED_SOLOMON; // used when encrypting
+const size_t DATA_COPIES = 2;
+const unsigned PAYLOAD_PARITY = 32; // RS parity bytes per 255-byte codeword (corrects 16 bytes each)
+
+// Cover synthesis settings
+const unsigned COVER_WIDTH = 720;
+const unsigned COVER_HEIGHT = 720;
+const unsigned COVER_BAND_ROWS = 16; // 16 rows of a 720px cover (~45 KB) stay cache resident
+const float COVER_NOISE_INTENSITY = 10.0f;
+
+// Data slots between the header and the tail reserve; a slot is the red byte of one pixel
+size_t dataSlotCount(size_t imageSize);
+size_t slotOffset(size_t slot);
+// Key and permutation seed for an image salt and its KDF settings, served from the key cache when possible
+bool deriveImageKey(const std::string& salt, const KdfSettings& kdf, std::string& key, unsigned& seed);
+
+// Returns the written filename, or an empty string on failure
+std::string encryptPassword(const std::string& password, const std::string& outDir = "");
+// Derives all keys up front, PBKDF2 ones in one batch, and synthesizes each cover on the same
+// number of threads (0 = one per core); empty names mark failures
+std::vector<std::string> encryptPasswords(const std::vector<std::string>& passwords, const std::string& outDir = "",
+                                          unsigned threads = 0);
 std::string decryptPassword(const std::string& filename);
+// Decrypts all files on a worker pool (0 = one thread per core); results keep input order
+std::vector<std::string> decryptPasswords(const std::vector<std::string>& filenames, unsigned threads = 0);
 std::vector<std::string> listEncFiles();
-void generateGradient(std::vector<unsigned char>& image, unsigned width, unsigned height, 
-                     const std::vector<unsigned char>& color1, const std::vector<unsigned char>& color2);
-void addNaturalNoise(std::vector<unsigned char>& image, unsigned width, unsigned height, float intensity);
-void addShapes(std::vector<unsigned char>& image, unsigned width, unsigned height, int numShapes, std::mt19937& rng);
\ No newline at end of file
+// Fused, band-parallel cover generator (0 threads = one per core); deterministic per seed
+void generateCoverImage(std::vector<unsigned char>& image, unsigned width, unsigned height,
+                        uint64_t seed, unsigned threads = 0);
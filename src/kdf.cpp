@@ -0,0 +1,239 @@
+#include "kdf.h"
+#include "crypto_utils.h"
+#include "pbkdf2_batch.h"
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cerrno>
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+#endif
+
+using namespace std;
+
+const uint32_t SCRYPT_DEFAULT_PARAMS[3] = {15, 8, 1};       // N = 32768, 32 MiB
+const uint32_t ARGON2_DEFAULT_PARAMS[3] = {3, 65536, 4};    // RFC 9106's 64 MiB recommendation
+const uint32_t SCRYPT_MAX_LOG2_N = 30;
+
+// Argon2 parameter names; the OSSL_KDF_PARAM_ARGON2_* macros only exist in OpenSSL 3.2+ headers
+const char* const ARGON2_PARAM_MEMCOST = "memcost";
+const char* const ARGON2_PARAM_LANES = "lanes";
+const char* const ARGON2_PARAM_THREADS = "threads";
+
+static KdfSettings currentSettings;
+static bool settingsChosen = false;
+
+// Reads up to three comma-separated unsigned values; missing ones keep their defaults
+static bool parseParams(const string& text, uint32_t params[3], size_t maxCount) {
+    size_t position = 0;
+    for (size_t i = 0; position <= text.length(); i++) {
+        const size_t comma = text.find(',', position);
+        const string field = text.substr(position, comma == string::npos ? string::npos : comma - position);
+        if (i >= maxCount || field.empty() || field.find_first_not_of("0123456789") != string::npos) {
+            return false;
+        }
+        
+        errno = 0;
+        const unsigned long value = strtoul(field.c_str(), nullptr, 10);
+        if (errno != 0 || value > 0xFFFFFFFFUL) {
+            return false;
+        }
+        params[i] = static_cast<uint32_t>(value);
+        
+        if (comma == string::npos) {
+            break;
+        }
+        position = comma + 1;
+    }
+    return true;
+}
+
+// Fetched at runtime, so a build against 3.0 headers still gains Argon2id from a 3.2+ libcrypto
+static bool argon2idAvailable() {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_KDF* kdf = EVP_KDF_fetch(nullptr, "ARGON2ID", nullptr);
+    EVP_KDF_free(kdf);
+    return kdf != nullptr;
+#else
+    return false;
+#endif
+}
+
+bool parseKdfSettings(const string& spec, KdfSettings& settings) {
+    const size_t colon = spec.find(':');
+    const string name = spec.substr(0, colon);
+    
+    KdfSettings parsed = KdfSettings();
+    size_t paramCount = 0;
+    if (name == "pbkdf2") {
+        parsed.algorithm = KDF_PBKDF2_SHA256;
+        parsed.params[0] = PBKDF2_ITERATIONS;
+        paramCount = 1;
+    } else if (name == "scrypt") {
+        parsed.algorithm = KDF_SCRYPT;
+        copy(SCRYPT_DEFAULT_PARAMS, SCRYPT_DEFAULT_PARAMS + 3, parsed.params);
+        paramCount = 3;
+    } else if (name == "argon2id") {
+        parsed.algorithm = KDF_ARGON2ID;
+        copy(ARGON2_DEFAULT_PARAMS, ARGON2_DEFAULT_PARAMS + 3, parsed.params);
+        paramCount = 3;
+    } else {
+        cerr << "Error: Unknown key derivation function \"" << name << "\"." << endl;
+        return false;
+    }
+    
+    if (colon != string::npos && !parseParams(spec.substr(colon + 1), parsed.params, paramCount)) {
+        cerr << "Error: Malformed parameters in \"" << spec << "\"." << endl;
+        return false;
+    }
+    if (!validateKdfSettings(parsed)) {
+        return false;
+    }
+    // Refused here rather than at derivation, so encrypt stops before it asks for anything
+    if (parsed.algorithm == KDF_ARGON2ID && !argon2idAvailable()) {
+        cerr << "Error: Argon2id needs OpenSSL 3.2 or newer." << endl;
+        return false;
+    }
+    settings = parsed;
+    return true;
+}
+
+bool validateKdfSettings(const KdfSettings& settings) {
+    const uint32_t* params = settings.params;
+    switch (settings.algorithm) {
+        case KDF_PBKDF2_SHA256:
+            if (params[0] == 0 || params[0] > PBKDF2_MAX_ITERATIONS) {
+                cerr << "Error: PBKDF2 iterations must be 1 to " << PBKDF2_MAX_ITERATIONS << "." << endl;
+                return false;
+            }
+            return true;
+        case KDF_SCRYPT: {
+            if (params[0] == 0 || params[0] > SCRYPT_MAX_LOG2_N || params[1] == 0 || params[2] == 0) {
+                cerr << "Error: Invalid scrypt parameters." << endl;
+                return false;
+            }
+            // The working set OpenSSL allocates: 128 * r * (N + p + 2) bytes
+            const uint64_t memory = 128ULL * params[1] * ((1ULL << params[0]) + params[2] + 2);
+            if (memory > KDF_MAX_MEMORY) {
+                cerr << "Error: scrypt parameters need more than " << (KDF_MAX_MEMORY >> 20) << " MiB." << endl;
+                return false;
+            }
+            return true;
+        }
+        case KDF_ARGON2ID:
+            if (params[0] == 0 || params[0] > ARGON2_MAX_PASSES || params[2] == 0 || params[2] > ARGON2_MAX_LANES ||
+                params[1] < 8 * params[2]) {
+                cerr << "Error: Invalid Argon2id parameters." << endl;
+                return false;
+            }
+            if (static_cast<uint64_t>(params[1]) * 1024 > KDF_MAX_MEMORY) {
+                cerr << "Error: Argon2id memory is limited to " << (KDF_MAX_MEMORY >> 10) << " KiB." << endl;
+                return false;
+            }
+            return true;
+        default:
+            cerr << "Error: Unsupported key derivation function " << static_cast<unsigned>(settings.algorithm) << "." << endl;
+            return false;
+    }
+}
+
+static KdfSettings environmentKdfSettings() {
+    KdfSettings settings = KdfSettings();
+    settings.algorithm = KDF_PBKDF2_SHA256;
+    settings.params[0] = PBKDF2_ITERATIONS;
+    
+    const char* spec = getenv("ENC_DEC_KDF");
+    if (spec != nullptr && !parseKdfSettings(spec, settings)) {
+        cerr << "Warning: Ignoring ENC_DEC_KDF; using PBKDF2 with " << PBKDF2_ITERATIONS << " iterations." << endl;
+    }
+    return settings;
+}
+
+void setKdfSettings(const KdfSettings& settings) {
+    currentSettings = settings;
+    settingsChosen = true;
+}
+
+KdfSettings kdfSettings() {
+    static const KdfSettings fromEnvironment = environmentKdfSettings();
+    return settingsChosen ? currentSettings : fromEnvironment;
+}
+
+static string scryptKey(const KdfSettings& settings, const string& password, const string& salt, size_t keyLength) {
+    string key(keyLength, '\0');
+    if (EVP_PBE_scrypt(password.data(), password.length(),
+                       reinterpret_cast<const unsigned char*>(salt.data()), salt.length(),
+                       1ULL << settings.params[0], settings.params[1], settings.params[2], KDF_MAX_MEMORY,
+                       reinterpret_cast<unsigned char*>(&key[0]), keyLength) != 1) {
+        cerr << "Error generating key using scrypt" << endl;
+        return "";
+    }
+    return key;
+}
+
+static string argon2idKey(const KdfSettings& settings, const string& password, const string& salt, size_t keyLength) {
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    EVP_KDF* kdf = EVP_KDF_fetch(nullptr, "ARGON2ID", nullptr);
+    if (kdf == nullptr) {
+        cerr << "Error: Argon2id needs OpenSSL 3.2 or newer." << endl;
+        return "";
+    }
+    EVP_KDF_CTX* context = EVP_KDF_CTX_new(kdf);
+    EVP_KDF_free(kdf);
+    if (context == nullptr) {
+        cerr << "Error generating key using Argon2id" << endl;
+        return "";
+    }
+    
+    uint32_t passes = settings.params[0];
+    uint64_t memory = settings.params[1];
+    uint32_t lanes = settings.params[2];
+    uint32_t threads = 1;
+    const OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_PASSWORD, const_cast<char*>(password.data()), password.length()),
+        OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_SALT, const_cast<char*>(salt.data()), salt.length()),
+        OSSL_PARAM_construct_uint32(OSSL_KDF_PARAM_ITER, &passes),
+        OSSL_PARAM_construct_uint64(ARGON2_PARAM_MEMCOST, &memory),
+        OSSL_PARAM_construct_uint32(ARGON2_PARAM_LANES, &lanes),
+        OSSL_PARAM_construct_uint32(ARGON2_PARAM_THREADS, &threads),
+        OSSL_PARAM_construct_end()
+    };
+    
+    string key(keyLength, '\0');
+    const bool ok = EVP_KDF_derive(context, reinterpret_cast<unsigned char*>(&key[0]), keyLength, params) == 1;
+    EVP_KDF_CTX_free(context);
+    if (!ok) {
+        cerr << "Error generating key using Argon2id" << endl;
+        return "";
+    }
+    return key;
+#else
+    (void)settings;
+    (void)password;
+    (void)salt;
+    (void)keyLength;
+    cerr << "Error: Argon2id needs OpenSSL 3.2 or newer." << endl;
+    return "";
+#endif
+}
+
+string deriveKdfKey(const KdfSettings& settings, const string& password, const string& salt, size_t keyLength) {
+    if (!validateKdfSettings(settings)) {
+        return "";
+    }
+    
+    switch (settings.algorithm) {
+        case KDF_PBKDF2_SHA256: {
+            const vector<Pbkdf2Job> jobs(1, Pbkdf2Job{password, salt, settings.params[0]});
+            return pbkdf2Batch(jobs, keyLength, 1)[0];
+        }
+        case KDF_SCRYPT:
+            return scryptKey(settings, password, salt, keyLength);
+        case KDF_ARGON2ID:
+            return argon2idKey(settings, password, salt, keyLength);
+        default:
+            return "";
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Key derivation functions. Every image records its algorithm and cost
+// parameters in the header, so the cost can be tuned per deployment
+// (ENC_DEC_KDF, or --kdf for encrypt) without touching images written earlier.
+const unsigned char KDF_PBKDF2_SHA256 = 0; // params: iterations
+const unsigned char KDF_SCRYPT = 1;        // params: log2(N), r, p
+const unsigned char KDF_ARGON2ID = 2;      // params: passes, memory in KiB, lanes (OpenSSL 3.2+)
+
+// Headers asking for more are rejected, so a crafted image cannot tie up the machine
+const uint32_t PBKDF2_MAX_ITERATIONS = 10000000;
+const uint32_t ARGON2_MAX_PASSES = 64;
+const uint32_t ARGON2_MAX_LANES = 64;
+const uint64_t KDF_MAX_MEMORY = 1024ULL * 1024 * 1024; // bytes, scrypt and Argon2id
+
+struct KdfSettings {
+    unsigned char algorithm; // KDF_*
+    uint32_t params[3];      // unused parameters are 0
+};
+
+// Parses "pbkdf2[:ITERATIONS]", "scrypt[:LOG2N,R,P]" or "argon2id[:PASSES,MEMORY_KIB,LANES]".
+// Without parameters the defaults are used: 100000; 15,8,1; 3,65536,4.
+// argon2id is refused when the libcrypto in use has no Argon2id.
+bool parseKdfSettings(const std::string& spec, KdfSettings& settings);
+// Reports unknown algorithms and costs outside the limits above on stderr
+bool validateKdfSettings(const KdfSettings& settings);
+
+// Settings for new images: ENC_DEC_KDF when set and valid, otherwise PBKDF2 with PBKDF2_ITERATIONS
+void setKdfSettings(const KdfSettings& settings);
+KdfSettings kdfSettings();
+
+// Returns keyLength bytes, or an empty string on failure
+std::string deriveKdfKey(const KdfSettings& settings, const std::string& password, const std::string& salt,
+                         size_t keyLength);
@@ -0,0 +1,158 @@
+#include "key_cache.h"
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+// Allocate whole pages for the cache so they can be locked as one region
+static void* allocateRegion(size_t size) {
+#ifdef _WIN32
+    return VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return region == MAP_FAILED ? nullptr : region;
+#endif
+}
+
+static void freeRegion(void* region, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    VirtualFree(region, 0, MEM_RELEASE);
+#else
+    munmap(region, size);
+#endif
+}
+
+static bool lockRegion(void* region, size_t size) {
+#ifdef _WIN32
+    return VirtualLock(region, size) != 0;
+#else
+#ifdef MADV_DONTDUMP
+    // Keep cached keys out of core dumps as well
+    madvise(region, size, MADV_DONTDUMP);
+#endif
+    return mlock(region, size) == 0;
+#endif
+}
+
+static void unlockRegion(void* region, size_t size) {
+#ifdef _WIN32
+    VirtualUnlock(region, size);
+#else
+    munlock(region, size);
+#endif
+}
+
+KeyCache::KeyCache(size_t capacity)
+    : entries(nullptr), entryCount(capacity), regionSize(capacity * sizeof(Entry)),
+      clock(0), locked(false) {
+    if (regionSize == 0) {
+        return;
+    }
+    
+    void* region = allocateRegion(regionSize);
+    if (region == nullptr) {
+        // Caching is an optimization only; run uncached rather than fail
+        entryCount = 0;
+        regionSize = 0;
+        return;
+    }
+    
+    // Running unlocked is acceptable when RLIMIT_MEMLOCK is too small
+    locked = lockRegion(region, regionSize);
+    
+    memset(region, 0, regionSize);
+    entries = static_cast<Entry*>(region);
+}
+
+KeyCache::~KeyCache() {
+    if (entries == nullptr) {
+        return;
+    }
+    
+    OPENSSL_cleanse(entries, regionSize);
+    if (locked) {
+        unlockRegion(entries, regionSize);
+    }
+    freeRegion(entries, regionSize);
+}
+
+KeyCache::Entry* KeyCache::findEntry(const string& salt) {
+    for (size_t i = 0; i < entryCount; i++) {
+        Entry& entry = entries[i];
+        if (entry.used && entry.saltLength == salt.size() &&
+            memcmp(entry.salt, salt.data(), salt.size()) == 0) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+bool KeyCache::lookup(const string& salt, string& key, unsigned& seed) {
+    if (salt.size() > KEY_CACHE_MAX_SALT) {
+        return false;
+    }
+    
+    lock_guard<std::mutex> guard(mutex);
+    
+    Entry* entry = findEntry(salt);
+    if (entry == nullptr) {
+        return false;
+    }
+    
+    entry->lastUse = ++clock;
+    key.assign(reinterpret_cast<const char*>(entry->key), AES_KEY_SIZE);
+    seed = entry->seed;
+    return true;
+}
+
+void KeyCache::insert(const string& salt, const string& key, unsigned seed) {
+    if (entryCount == 0 || salt.size() > KEY_CACHE_MAX_SALT ||
+        key.size() != static_cast<size_t>(AES_KEY_SIZE)) {
+        return;
+    }
+    
+    lock_guard<std::mutex> guard(mutex);
+    
+    Entry* target = findEntry(salt);
+    if (target == nullptr) {
+        // Take a free slot, otherwise evict the least recently used entry
+        target = &entries[0];
+        for (size_t i = 0; i < entryCount; i++) {
+            if (!entries[i].used) {
+                target = &entries[i];
+                break;
+            }
+            if (entries[i].lastUse < target->lastUse) {
+                target = &entries[i];
+            }
+        }
+        OPENSSL_cleanse(target, sizeof(Entry));
+    }
+    
+    memcpy(target->salt, salt.data(), salt.size());
+    memcpy(target->key, key.data(), AES_KEY_SIZE);
+    target->saltLength = salt.size();
+    target->seed = seed;
+    target->lastUse = ++clock;
+    target->used = true;
+}
+
+void KeyCache::clear() {
+    lock_guard<std::mutex> guard(mutex);
+    
+    if (entries != nullptr) {
+        OPENSSL_cleanse(entries, regionSize);
+    }
+    clock = 0;
+}
+
+KeyCache& KeyCache::instance() {
+    static KeyCache cache;
+    return cache;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <cstdint>
+#include "crypto_utils.h"
+
+const size_t KEY_CACHE_CAPACITY = 64; // Number of salts remembered per process
+const size_t KEY_CACHE_MAX_SALT = 64; // Longer salts bypass the cache
+
+// Bounded LRU cache from salt to PBKDF2-derived key and permutation seed.
+// Entries live in a single page-locked region (when the OS allows it) so
+// cached keys are never swapped out, and are wiped when evicted or cleared.
+class KeyCache {
+public:
+    explicit KeyCache(size_t capacity = KEY_CACHE_CAPACITY);
+    ~KeyCache();
+    
+    bool lookup(const std::string& salt, std::string& key, unsigned& seed);
+    void insert(const std::string& salt, const std::string& key, unsigned seed);
+    void clear();
+    
+    size_t capacity() const { return entryCount; }
+    bool isLocked() const { return locked; }
+    
+    // Process-wide cache shared by encryptPassword/decryptPassword
+    static KeyCache& instance();
+    
+private:
+    struct Entry {
+        unsigned char salt[KEY_CACHE_MAX_SALT];
+        unsigned char key[AES_KEY_SIZE];
+        size_t saltLength;
+        unsigned seed;
+        uint64_t lastUse;
+        bool used;
+    };
+    
+    KeyCache(const KeyCache&);
+    KeyCache& operator=(const KeyCache&);
+    
+    Entry* findEntry(const std::string& salt);
+    
+    Entry* entries;
+    size_t entryCount;
+    size_t regionSize;
+    uint64_t clock;
+    bool locked;
+    std::mutex mutex;
+};
@@ -0,0 +1,188 @@
+#include "legacy_image.h"
+#include "image_utils.h"
+#include "crypto_utils.h"
+#include "vote.h"
+#include <iostream>
+#include <random>
+#include <algorithm>
+
+using namespace std;
+
+// Field offsets from the start of the image; the other copies mirror them
+// backwards from the end of row 0 or from the end of the image
+const size_t LEGACY_SALT = 20;
+const size_t LEGACY_IV = 100;
+const size_t LEGACY_HASH = 200;
+const size_t LEGACY_HMAC = 400;
+const size_t LEGACY_TAIL_HMAC = 40;
+const size_t LEGACY_DATA_COPIES = 2;
+
+// Two agreeing copies win; otherwise the first non-zero one, as the old reader did
+static unsigned char voteThree(unsigned char a, unsigned char b, unsigned char c, bool& corrupted) {
+    if (a == b || a == c) return a;
+    if (b == c) return b;
+    corrupted = true;
+    return a != 0 ? a : (b != 0 ? b : c);
+}
+
+bool readLegacyHeader(SparsePngReader& reader, ImageHeader& header) {
+    const size_t stride = static_cast<size_t>(reader.width()) * 4;
+    if (reader.height() < LEGACY_METADATA_ROWS || stride < LEGACY_HMAC + HMAC_SIZE) {
+        cerr << "Error: No password image header found." << endl;
+        return false;
+    }
+    
+    unsigned error = reader.retainRows(LEGACY_METADATA_ROWS);
+    if (error) {
+        cerr << "Error decoding image: " << lodepng_error_text(error) << endl;
+        return false;
+    }
+    
+    // Ciphertext length, little endian, at three places
+    const size_t lengthOffsets[3] = {0, stride - 4, 2 * stride};
+    uint32_t lengths[3] = {0, 0, 0};
+    for (int c = 0; c < 3; c++) {
+        for (int i = 0; i < 4; i++) {
+            lengths[c] |= static_cast<uint32_t>(reader.retainedByte(lengthOffsets[c] + i)) << (i * 8);
+        }
+    }
+    
+    header = ImageHeader();
+    if (lengths[0] == lengths[1] || lengths[0] == lengths[2]) {
+        header.payloadLength = lengths[0];
+    } else if (lengths[1] == lengths[2]) {
+        header.payloadLength = lengths[1];
+    } else {
+        sort(lengths, lengths + 3);
+        header.payloadLength = lengths[1];
+    }
+    if (lengths[0] != lengths[1] || lengths[1] != lengths[2]) {
+        cerr << "Warning: Size data was corrupted but recovered using redundancy." << endl;
+    }
+    
+    // Salt, forwards from LEGACY_SALT and backwards from the end of row 0
+    bool saltCorrupted = false;
+    for (size_t i = 0; i < HEADER_SALT_SIZE; i++) {
+        const unsigned char first = reader.retainedByte(LEGACY_SALT + i);
+        const unsigned char second = reader.retainedByte(stride - LEGACY_SALT - i);
+        if (first != second) {
+            saltCorrupted = true;
+        }
+        header.salt[i] = first == second || first != 0 ? first : second;
+    }
+    if (saltCorrupted) {
+        cerr << "Warning: Salt was corrupted but attempted recovery." << endl;
+    }
+    
+    header.version = LEGACY_HEADER_VERSION;
+    header.layout = IMAGE_LAYOUT_SINGLE;
+    header.codec = PAYLOAD_CODEC_REPETITION;
+    header.cipher = CIPHER_AES_256_CBC_HMAC;
+    header.kdf.algorithm = KDF_PBKDF2_SHA256;
+    header.kdf.params[0] = PBKDF2_ITERATIONS;
+    return true;
+}
+
+string decryptLegacyImage(SparsePngReader& reader, const ImageHeader& header, const string& key, unsigned seed) {
+    const size_t stride = static_cast<size_t>(reader.width()) * 4;
+    const size_t imageSize = stride * reader.height();
+    const size_t encLen = header.payloadLength;
+    
+    // The old slot order: every slot offset, shuffled in place. std::shuffle is
+    // implementation-defined; these images were written with libstdc++'s.
+    vector<size_t> indices(dataSlotCount(imageSize));
+    for (size_t i = 0; i < indices.size(); i++) {
+        indices[i] = slotOffset(i);
+    }
+    mt19937 generator(seed);
+    shuffle(indices.begin(), indices.end(), generator);
+    
+    const size_t copyStride = indices.size() / 3;
+    if (encLen == 0 || encLen > copyStride) {
+        cerr << "Error: Invalid payload size." << endl;
+        return "";
+    }
+    
+    // One gather for everything past the salt: payload copies, then three IV
+    // copies, three HMAC copies and two password hash copies
+    vector<size_t> offsets;
+    offsets.reserve(LEGACY_DATA_COPIES * encLen + 3 * AES_BLOCK_SIZE + 3 * HMAC_SIZE + 2 * HEADER_HASH_SIZE);
+    for (size_t c = 0; c < LEGACY_DATA_COPIES; c++) {
+        for (size_t i = 0; i < encLen; i++) {
+            offsets.push_back(indices[c * copyStride + i]);
+        }
+    }
+    const size_t center = (static_cast<size_t>(reader.height() / 2) * reader.width() + reader.width() / 2) * 4;
+    for (int i = 0; i < AES_BLOCK_SIZE; i++) {
+        offsets.push_back(LEGACY_IV + i);
+        offsets.push_back(stride - LEGACY_IV - i);
+        offsets.push_back(center + i);
+    }
+    for (int i = 0; i < HMAC_SIZE; i++) {
+        offsets.push_back(imageSize - LEGACY_TAIL_HMAC - i);
+        offsets.push_back(imageSize - LEGACY_TAIL_HMAC - HMAC_SIZE - i);
+        offsets.push_back(LEGACY_HMAC + i);
+    }
+    for (size_t i = 0; i < HEADER_HASH_SIZE; i++) {
+        offsets.push_back(LEGACY_HASH + i);
+        offsets.push_back(imageSize - LEGACY_HASH - i);
+    }
+    
+    vector<unsigned char> values;
+    unsigned error = reader.gather(offsets, values);
+    if (error) {
+        cerr << "Error decoding image: " << lodepng_error_text(error) << endl;
+        return "";
+    }
+    
+    // Vote the data copies byte by byte; ties pick the smallest value
+    vector<unsigned char> encryptedData(encLen);
+    voteBytes(values.data(), LEGACY_DATA_COPIES, encLen, encryptedData.data());
+    const unsigned char* field = values.data() + LEGACY_DATA_COPIES * encLen;
+    
+    vector<unsigned char> iv(AES_BLOCK_SIZE);
+    bool ivCorrupted = false;
+    for (int i = 0; i < AES_BLOCK_SIZE; i++, field += 3) {
+        iv[i] = voteThree(field[0], field[1], field[2], ivCorrupted);
+    }
+    if (ivCorrupted) {
+        cerr << "Warning: IV was corrupted but repaired using redundant data." << endl;
+    }
+    
+    // Any of the three stored HMACs may confirm the data
+    vector<vector<unsigned char>> storedHmacs(3, vector<unsigned char>(HMAC_SIZE));
+    for (int i = 0; i < HMAC_SIZE; i++, field += 3) {
+        for (int c = 0; c < 3; c++) {
+            storedHmacs[c][i] = field[c];
+        }
+    }
+    const bool hmacVerified = verifyHMAC(encryptedData, storedHmacs[0], key) ||
+                              verifyHMAC(encryptedData, storedHmacs[1], key) ||
+                              verifyHMAC(encryptedData, storedHmacs[2], key);
+    if (!hmacVerified) {
+        cerr << "Warning: HMAC verification failed. Data integrity cannot be guaranteed." << endl;
+    } else {
+        cerr << "HMAC verification successful. Data integrity confirmed." << endl;
+    }
+    
+    const string password = aesDecrypt(encryptedData, key, iv);
+    if (password.empty()) {
+        return "";
+    }
+    
+    // Both stored copies of the hash prefix are checked
+    const string passwordHash = sha256(password);
+    int validHashes = 0;
+    for (size_t i = 0; i < HEADER_HASH_SIZE; i++, field += 2) {
+        const unsigned char expected = static_cast<unsigned char>(passwordHash[i]);
+        if (field[0] == expected) validHashes++;
+        if (field[1] == expected) validHashes++;
+    }
+    
+    const float hashValidityPercentage = validHashes * 100.0f / (2 * HEADER_HASH_SIZE);
+    cerr << "Password hash verification: " << hashValidityPercentage << "% valid" << endl;
+    if (hashValidityPercentage < 30.0f) {
+        cerr << "Warning: Password verification failed. The data may be corrupted." << endl;
+    }
+    return password;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <string>
+#include "image_header.h"
+#include "png_stream.h"
+
+// Images written before the versioned header existed carry no "P2IH" magic.
+// Their metadata sits at fixed offsets, two or three copies of each field; the
+// key is PBKDF2 over the salt with PBKDF2_ITERATIONS, the cipher AES-256-CBC
+// with an HMAC-SHA256, and the payload is two copies placed by a std::shuffle
+// of the data slots driven by mt19937. They are still read, never written.
+const unsigned char LEGACY_HEADER_VERSION = 0; // marks headers filled in by readLegacyHeader
+const unsigned LEGACY_METADATA_ROWS = 3;       // the third copy of the length is in row 2
+
+// Retains the metadata rows and fills header with the voted length and salt and
+// the fixed KDF and cipher. Must be called before the reader gathers anything.
+bool readLegacyHeader(SparsePngReader& reader, ImageHeader& header);
+// Gathers and votes the remaining metadata and the payload, verifies and decrypts;
+// returns an empty string on failure
+std::string decryptLegacyImage(SparsePngReader& reader, const ImageHeader& header, const std::string& key,
+                               unsigned seed);
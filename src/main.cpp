@@ -1,17 +1,38 @@
 #include "../Include/lodepng.h"
 #include "image_utils.h"
 #include "crypto_utils.h"
+#include "png_codec.h"
+#include "container.h"
+#include "pbkdf2_batch.h"
+#include "kdf.h"
 #include <iostream>
+#include <fstream>
 #include <vector>
 #include <string>
+#include <cstdlib>
+#include <cerrno>
+#include <sys/stat.h>
 
 using namespace std;
 
+const unsigned long MAX_THREADS = 1024; // upper bound for --threads
+
 void showMenu();
+void showUsage(const char* program);
+bool authenticate();
+bool parseThreadCount(const string& text, unsigned& threads);
+int runBatch(int argc, char* argv[]);
+int runEncryptBatch(istream& in, const string& outDir, unsigned threads);
+int runDecryptBatch(const vector<string>& files, unsigned threads);
+int runContainer(int argc, char* argv[]);
 
-int main() {
+int main(int argc, char* argv[]) {
     srand(static_cast<unsigned int>(time(nullptr)));
     
+    if (argc > 1) {
+        return runBatch(argc, argv);
+    }
+    
     cout << "Enter program access password: ";
     string inputPassword;
     cin >> inputPassword;
@@ -34,7 +55,10 @@ int main() {
             cout << "Enter password to encrypt: ";
             string password;
             getline(cin, password);
-            encryptPassword(password);
+            string filename = encryptPassword(password);
+            if (!filename.empty()) {
+                cout << "Password encrypted to file: " << filename << endl;
+            }
         } else if (choice == 2) {
             auto files = listEncFiles();
             if (files.empty()) {
@@ -60,6 +84,17 @@ int main() {
             string decrypted = decryptPassword(files[fileIndex - 1]);
             cout << "Decrypted password: " << decrypted << endl;
         } else if (choice == 3) {
+            auto files = listEncFiles();
+            if (files.empty()) {
+                cout << "No encrypted files found." << endl;
+                continue;
+            }
+            
+            auto passwords = decryptPasswords(files);
+            for (size_t i = 0; i < files.size(); i++) {
+                cout << files[i] << ": " << passwords[i] << endl;
+            }
+        } else if (choice == 4) {
             break;
         } else {
             cout << "Invalid choice." << endl;
@@ -73,6 +108,288 @@ void showMenu() {
     cout << "\n=== Password Encryption/Decryption ===" << endl;
     cout << "1. Encrypt Password" << endl;
     cout << "2. Decrypt Password" << endl;
-    cout << "3. Exit" << endl;
+    cout << "3. Decrypt All Passwords" << endl;
+    cout << "4. Exit" << endl;
     cout << "Enter your choice: ";
 }
+
+void showUsage(const char* program) {
+    cerr << "Usage:" << endl;
+    cerr << "  " << program << "                                      Interactive menu" << endl;
+    cerr << "  " << program << " encrypt [--in FILE] [--out-dir DIR] [--profile fastest|balanced|smallest]" << endl;
+    cerr << "  " << program << "         [--threads N] [--kdf pbkdf2[:ITER]|scrypt[:LOG2N,R,P]|argon2id[:PASSES,KIB,LANES]]" << endl;
+    cerr << "  " << program << "                                      Encrypt one secret per line (default: stdin)" << endl;
+    cerr << "  " << program << " decrypt [--threads N] FILE...        Decrypt each image, printing FILE<TAB>password" << endl;
+    cerr << "  " << program << " decrypt [--threads N] --all          Decrypt every enc_*.png in the current directory" << endl;
+    cerr << "  " << program << " container add FILE NAME              Add a secret (read from stdin) to a container" << endl;
+    cerr << "  " << program << " container get FILE NAME              Print one secret from a container" << endl;
+    cerr << "  " << program << " container list FILE                  Print the entry names in a container" << endl;
+    cerr << "The access password is read from ENC_DEC_ACCESS_PASSWORD, or prompted for on stderr." << endl;
+    cerr << "ENC_DEC_KDF sets the default --kdf, also for the interactive menu and containers." << endl;
+}
+
+// Batch mode asks for the access password once, before any work is done
+bool authenticate() {
+    const char* envPassword = getenv("ENC_DEC_ACCESS_PASSWORD");
+    string inputPassword;
+    
+    if (envPassword != nullptr) {
+        inputPassword = envPassword;
+    } else {
+        cerr << "Enter program access password: ";
+        getline(cin, inputPassword);
+    }
+    
+    if (!checkAccessPassword(inputPassword)) {
+        cerr << "Invalid password. Exiting..." << endl;
+        return false;
+    }
+    return true;
+}
+
+// --threads takes a decimal count; 0 means one thread per core
+bool parseThreadCount(const string& text, unsigned& threads) {
+    errno = 0;
+    const unsigned long value = strtoul(text.c_str(), nullptr, 10);
+    if (text.empty() || text.find_first_not_of("0123456789") != string::npos || errno != 0 || value > MAX_THREADS) {
+        cerr << "Invalid thread count: " << text << endl;
+        return false;
+    }
+    threads = static_cast<unsigned>(value);
+    return true;
+}
+
+int runBatch(int argc, char* argv[]) {
+    const string command = argv[1];
+    
+    if (command == "-h" || command == "--help" || command == "help") {
+        showUsage(argv[0]);
+        return 0;
+    }
+    
+    if (command == "encrypt") {
+        string inPath = "-";
+        string outDir;
+        unsigned threads = 0;
+        
+        for (int i = 2; i < argc; i++) {
+            const string arg = argv[i];
+            if (arg == "--in" && i + 1 < argc) {
+                inPath = argv[++i];
+            } else if (arg == "--out-dir" && i + 1 < argc) {
+                outDir = argv[++i];
+            } else if (arg == "--profile" && i + 1 < argc) {
+                PngEncodeProfile profile;
+                if (!parsePngEncodeProfile(argv[++i], profile)) {
+                    cerr << "Unknown encode profile: " << argv[i] << endl;
+                    return 2;
+                }
+                setPngEncodeProfile(profile);
+            } else if (arg == "--threads" && i + 1 < argc) {
+                if (!parseThreadCount(argv[++i], threads)) {
+                    return 2;
+                }
+            } else if (arg == "--kdf" && i + 1 < argc) {
+                // parseKdfSettings explains what is wrong with the spec
+                KdfSettings settings;
+                if (!parseKdfSettings(argv[++i], settings)) {
+                    return 2;
+                }
+                setKdfSettings(settings);
+            } else {
+                cerr << "Unknown argument: " << arg << endl;
+                showUsage(argv[0]);
+                return 2;
+            }
+        }
+        
+        // Checked once up front; otherwise a bad directory only shows when the first image is written
+        struct stat outInfo;
+        if (!outDir.empty() && (stat(outDir.c_str(), &outInfo) != 0 || !S_ISDIR(outInfo.st_mode))) {
+            cerr << "Error: Output directory " << outDir << " does not exist or is not a directory." << endl;
+            return 2;
+        }
+        
+        // Secrets on stdin and an interactive prompt would compete for the same stream
+        if (inPath == "-" && getenv("ENC_DEC_ACCESS_PASSWORD") == nullptr) {
+            cerr << "Reading secrets from stdin requires ENC_DEC_ACCESS_PASSWORD to be set." << endl;
+            return 2;
+        }
+        
+        if (!authenticate()) {
+            return 1;
+        }
+        
+        if (inPath == "-") {
+            return runEncryptBatch(cin, outDir, threads);
+        }
+        
+        ifstream in(inPath.c_str());
+        if (!in) {
+            cerr << "Error: Cannot open input file " << inPath << endl;
+            return 1;
+        }
+        return runEncryptBatch(in, outDir, threads);
+    }
+    
+    if (command == "decrypt") {
+        vector<string> files;
+        unsigned threads = 0;
+        bool all = false;
+        
+        for (int i = 2; i < argc; i++) {
+            const string arg = argv[i];
+            if (arg == "--threads" && i + 1 < argc) {
+                if (!parseThreadCount(argv[++i], threads)) {
+                    return 2;
+                }
+            } else if (arg == "--all") {
+                all = true;
+            } else if (arg.compare(0, 2, "--") == 0) {
+                cerr << "Unknown argument: " << arg << endl;
+                showUsage(argv[0]);
+                return 2;
+            } else {
+                files.push_back(arg);
+            }
+        }
+        
+        if (all) {
+            auto found = listEncFiles();
+            files.insert(files.end(), found.begin(), found.end());
+        }
+        
+        if (files.empty()) {
+            showUsage(argv[0]);
+            return 2;
+        }
+        
+        if (!authenticate()) {
+            return 1;
+        }
+        
+        return runDecryptBatch(files, threads);
+    }
+    
+    if (command == "container") {
+        return runContainer(argc, argv);
+    }
+    
+    cerr << "Unknown command: " << command << endl;
+    showUsage(argv[0]);
+    return 2;
+}
+
+// Encrypts every line of the input and prints the resulting filename per line
+int runEncryptBatch(istream& in, const string& outDir, unsigned threads) {
+    OPENSSL_init_crypto(0, nullptr);
+    setPngEncodeThreads(threads);
+    
+    int failures = 0;
+    string password;
+    vector<string> chunk;
+    
+    // Lines are encrypted in chunks so each chunk's keys come from one PBKDF2 batch
+    auto flush = [&]() {
+        const vector<string> filenames = encryptPasswords(chunk, outDir, threads);
+        for (const auto& filename : filenames) {
+            if (filename.empty()) {
+                failures++;
+                continue;
+            }
+            cout << filename << endl;
+        }
+        chunk.clear();
+    };
+    
+    while (getline(in, password)) {
+        if (!password.empty() && password[password.length() - 1] == '\r') {
+            password.erase(password.length() - 1);
+        }
+        if (password.empty()) {
+            continue;
+        }
+        
+        chunk.push_back(password);
+        if (chunk.size() == PBKDF2_BATCH_CHUNK) {
+            flush();
+        }
+    }
+    if (!chunk.empty()) {
+        flush();
+    }
+    
+    return failures == 0 ? 0 : 1;
+}
+
+// Decrypts the files in parallel and prints "filename<TAB>password" per line, in input order
+int runDecryptBatch(const vector<string>& files, unsigned threads) {
+    OPENSSL_init_crypto(0, nullptr);
+    
+    auto passwords = decryptPasswords(files, threads);
+    
+    int failures = 0;
+    for (size_t i = 0; i < files.size(); i++) {
+        if (passwords[i].empty()) {
+            cerr << "Error: Failed to decrypt " << files[i] << endl;
+            failures++;
+            continue;
+        }
+        cout << files[i] << "\t" << passwords[i] << endl;
+    }
+    
+    return failures == 0 ? 0 : 1;
+}
+
+// container add|get|list; each call opens the container image once
+int runContainer(int argc, char* argv[]) {
+    const string action = argc > 2 ? argv[2] : "";
+    const bool withName = action == "add" || action == "get";
+    
+    if ((withName && argc != 5) || (action == "list" && argc != 4) || (!withName && action != "list")) {
+        showUsage(argv[0]);
+        return 2;
+    }
+    
+    if (!authenticate()) {
+        return 1;
+    }
+    OPENSSL_init_crypto(0, nullptr);
+    
+    const string filename = argv[3];
+    
+    if (action == "list") {
+        vector<string> names;
+        if (!containerList(filename, names)) {
+            return 1;
+        }
+        for (const auto& name : names) {
+            cout << name << endl;
+        }
+        return 0;
+    }
+    
+    const string name = argv[4];
+    
+    if (action == "get") {
+        string secret;
+        if (!containerGet(filename, name, secret)) {
+            return 1;
+        }
+        cout << secret << endl;
+        return 0;
+    }
+    
+    cerr << "Enter secret for " << name << ": ";
+    string secret;
+    getline(cin, secret);
+    if (!secret.empty() && secret[secret.length() - 1] == '\r') {
+        secret.erase(secret.length() - 1);
+    }
+    if (secret.empty()) {
+        cerr << "Error: Empty secret." << endl;
+        return 1;
+    }
+    
+    return containerAdd(filename, name, secret) ? 0 : 1;
+}
@@ -0,0 +1,495 @@
+#include "pbkdf2_batch.h"
+#include "cpu_features.h"
+#include "worker_pool.h"
+#include <openssl/crypto.h>
+#include <openssl/evp.h>
+#include <algorithm>
+#include <cstring>
+
+#ifdef ENC_DEC_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+const size_t SHA256_BLOCK_SIZE = 64;
+// An iteration hashes one 32-byte digest after the 64-byte HMAC pad block
+const uint32_t ITERATION_MESSAGE_BITS = (64 + 32) * 8;
+const uint32_t SHA256_PAD_WORD = 0x80000000;
+
+static const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t SHA256_INITIAL[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+// One PBKDF2 output block (T_i) being derived
+struct Pbkdf2Lane {
+    uint32_t inner[8]; // state after hashing key ^ ipad
+    uint32_t outer[8]; // state after hashing key ^ opad
+    uint32_t u[8];     // U_n
+    uint32_t t[8];     // U_1 ^ ... ^ U_n
+    uint32_t iterations;
+    size_t job;
+    size_t block;
+};
+
+static inline uint32_t rotr(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static inline uint32_t loadBigEndian32(const unsigned char* in) {
+    return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+           (static_cast<uint32_t>(in[2]) << 8) | static_cast<uint32_t>(in[3]);
+}
+
+static inline void storeBigEndian32(unsigned char* out, uint32_t value) {
+    out[0] = static_cast<unsigned char>(value >> 24);
+    out[1] = static_cast<unsigned char>(value >> 16);
+    out[2] = static_cast<unsigned char>(value >> 8);
+    out[3] = static_cast<unsigned char>(value);
+}
+
+static void sha256Compress(uint32_t state[8], const uint32_t block[16]) {
+    uint32_t w[64];
+    memcpy(w, block, 16 * sizeof(uint32_t));
+    for (int i = 16; i < 64; i++) {
+        const uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        const uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        const uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        const uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+// Hashes data and the final padding into state, which already holds prefixBytes of message
+static void sha256Finish(uint32_t state[8], const unsigned char* data, size_t length, uint64_t prefixBytes) {
+    const uint64_t messageBits = (prefixBytes + length) * 8;
+    uint32_t block[16];
+    
+    for (; length >= SHA256_BLOCK_SIZE; data += SHA256_BLOCK_SIZE, length -= SHA256_BLOCK_SIZE) {
+        for (int i = 0; i < 16; i++) {
+            block[i] = loadBigEndian32(data + i * 4);
+        }
+        sha256Compress(state, block);
+    }
+    
+    unsigned char tail[2 * SHA256_BLOCK_SIZE];
+    memset(tail, 0, sizeof(tail));
+    memcpy(tail, data, length);
+    tail[length] = 0x80;
+    const size_t tailSize = length + 9 > SHA256_BLOCK_SIZE ? 2 * SHA256_BLOCK_SIZE : SHA256_BLOCK_SIZE;
+    storeBigEndian32(tail + tailSize - 8, static_cast<uint32_t>(messageBits >> 32));
+    storeBigEndian32(tail + tailSize - 4, static_cast<uint32_t>(messageBits));
+    
+    for (size_t offset = 0; offset < tailSize; offset += SHA256_BLOCK_SIZE) {
+        for (int i = 0; i < 16; i++) {
+            block[i] = loadBigEndian32(tail + offset + i * 4);
+        }
+        sha256Compress(state, block);
+    }
+    OPENSSL_cleanse(tail, sizeof(tail));
+}
+
+// Hashes the HMAC pads and computes U_1 = HMAC(password, salt || INT(block + 1))
+static void prepareLane(const Pbkdf2Job& job, size_t jobIndex, size_t block, Pbkdf2Lane& lane) {
+    unsigned char key[SHA256_BLOCK_SIZE];
+    memset(key, 0, sizeof(key));
+    if (job.password.length() > SHA256_BLOCK_SIZE) {
+        uint32_t digest[8];
+        memcpy(digest, SHA256_INITIAL, sizeof(digest));
+        sha256Finish(digest, reinterpret_cast<const unsigned char*>(job.password.data()), job.password.length(), 0);
+        for (int i = 0; i < 8; i++) {
+            storeBigEndian32(key + i * 4, digest[i]);
+        }
+    } else {
+        memcpy(key, job.password.data(), job.password.length());
+    }
+    
+    uint32_t pad[16];
+    memcpy(lane.inner, SHA256_INITIAL, sizeof(lane.inner));
+    for (int i = 0; i < 16; i++) {
+        pad[i] = loadBigEndian32(key + i * 4) ^ 0x36363636;
+    }
+    sha256Compress(lane.inner, pad);
+    memcpy(lane.outer, SHA256_INITIAL, sizeof(lane.outer));
+    for (int i = 0; i < 16; i++) {
+        pad[i] = loadBigEndian32(key + i * 4) ^ 0x5c5c5c5c;
+    }
+    sha256Compress(lane.outer, pad);
+    
+    string message = job.salt;
+    unsigned char index[4];
+    storeBigEndian32(index, static_cast<uint32_t>(block + 1));
+    message.append(reinterpret_cast<const char*>(index), 4);
+    
+    uint32_t digest[8];
+    memcpy(digest, lane.inner, sizeof(digest));
+    sha256Finish(digest, reinterpret_cast<const unsigned char*>(message.data()), message.length(), SHA256_BLOCK_SIZE);
+    
+    uint32_t outerBlock[16] = {0};
+    memcpy(outerBlock, digest, sizeof(digest));
+    outerBlock[8] = SHA256_PAD_WORD;
+    outerBlock[15] = ITERATION_MESSAGE_BITS;
+    memcpy(lane.u, lane.outer, sizeof(lane.u));
+    sha256Compress(lane.u, outerBlock);
+    memcpy(lane.t, lane.u, sizeof(lane.t));
+    
+    lane.iterations = job.iterations;
+    lane.job = jobIndex;
+    lane.block = block;
+    
+    OPENSSL_cleanse(key, sizeof(key));
+    OPENSSL_cleanse(pad, sizeof(pad));
+    OPENSSL_cleanse(digest, sizeof(digest));
+    OPENSSL_cleanse(outerBlock, sizeof(outerBlock));
+}
+
+// Runs iterations 2..n for a group of lanes with equal iteration counts
+typedef void (*Pbkdf2Kernel)(Pbkdf2Lane* lanes, uint32_t rounds);
+
+#ifdef ENC_DEC_X86_SIMD
+// SHA-NI keeps the state as ABEF/CDGH word pairs
+SIMD_TARGET("sse4.1")
+static inline void toShaNiState(const uint32_t* state, __m128i& abef, __m128i& cdgh) {
+    const __m128i cdab = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xB1);
+    const __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1B);
+    abef = _mm_alignr_epi8(cdab, efgh, 8);
+    cdgh = _mm_blend_epi16(efgh, cdab, 0xF0);
+}
+
+// Back to message order: abcd and efgh hold words 0-3 and 4-7
+SIMD_TARGET("sse4.1")
+static inline void fromShaNiState(__m128i abef, __m128i cdgh, __m128i& abcd, __m128i& efgh) {
+    const __m128i feba = _mm_shuffle_epi32(abef, 0x1B);
+    const __m128i dchg = _mm_shuffle_epi32(cdgh, 0xB1);
+    abcd = _mm_blend_epi16(feba, dchg, 0xF0);
+    efgh = _mm_alignr_epi8(dchg, feba, 8);
+}
+
+// 64 rounds for two independent messages at once, hiding sha256rnds2 latency
+SIMD_TARGET("sha,sse4.1")
+static inline void sha256RoundsShaNi2(__m128i& abef0, __m128i& cdgh0, __m128i msg0[4],
+                                      __m128i& abef1, __m128i& cdgh1, __m128i msg1[4]) {
+    for (int g = 0; g < 16; g++) {
+        if (g >= 4) {
+            msg0[g & 3] = _mm_sha256msg2_epu32(
+                _mm_add_epi32(_mm_sha256msg1_epu32(msg0[g & 3], msg0[(g + 1) & 3]),
+                              _mm_alignr_epi8(msg0[(g + 3) & 3], msg0[(g + 2) & 3], 4)),
+                msg0[(g + 3) & 3]);
+            msg1[g & 3] = _mm_sha256msg2_epu32(
+                _mm_add_epi32(_mm_sha256msg1_epu32(msg1[g & 3], msg1[(g + 1) & 3]),
+                              _mm_alignr_epi8(msg1[(g + 3) & 3], msg1[(g + 2) & 3], 4)),
+                msg1[(g + 3) & 3]);
+        }
+        
+        const __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(SHA256_K + g * 4));
+        __m128i m0 = _mm_add_epi32(msg0[g & 3], k);
+        __m128i m1 = _mm_add_epi32(msg1[g & 3], k);
+        cdgh0 = _mm_sha256rnds2_epu32(cdgh0, abef0, m0);
+        cdgh1 = _mm_sha256rnds2_epu32(cdgh1, abef1, m1);
+        m0 = _mm_shuffle_epi32(m0, 0x0E);
+        m1 = _mm_shuffle_epi32(m1, 0x0E);
+        abef0 = _mm_sha256rnds2_epu32(abef0, cdgh0, m0);
+        abef1 = _mm_sha256rnds2_epu32(abef1, cdgh1, m1);
+    }
+}
+
+SIMD_TARGET("sha,sse4.1")
+static void pbkdf2RoundsShaNi(Pbkdf2Lane* lanes, uint32_t rounds) {
+    __m128i innerAbef[2], innerCdgh[2], outerAbef[2], outerCdgh[2];
+    __m128i u[2][2], t[2][2];
+    for (int l = 0; l < 2; l++) {
+        toShaNiState(lanes[l].inner, innerAbef[l], innerCdgh[l]);
+        toShaNiState(lanes[l].outer, outerAbef[l], outerCdgh[l]);
+        for (int i = 0; i < 2; i++) {
+            u[l][i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes[l].u + i * 4));
+            t[l][i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes[l].t + i * 4));
+        }
+    }
+    const __m128i pad0 = _mm_set_epi32(0, 0, 0, static_cast<int>(SHA256_PAD_WORD));
+    const __m128i pad1 = _mm_set_epi32(static_cast<int>(ITERATION_MESSAGE_BITS), 0, 0, 0);
+    
+    for (uint32_t r = 0; r < rounds; r++) {
+        __m128i msg0[4] = {u[0][0], u[0][1], pad0, pad1};
+        __m128i msg1[4] = {u[1][0], u[1][1], pad0, pad1};
+        __m128i abef0 = innerAbef[0], cdgh0 = innerCdgh[0];
+        __m128i abef1 = innerAbef[1], cdgh1 = innerCdgh[1];
+        sha256RoundsShaNi2(abef0, cdgh0, msg0, abef1, cdgh1, msg1);
+        fromShaNiState(_mm_add_epi32(abef0, innerAbef[0]), _mm_add_epi32(cdgh0, innerCdgh[0]), msg0[0], msg0[1]);
+        fromShaNiState(_mm_add_epi32(abef1, innerAbef[1]), _mm_add_epi32(cdgh1, innerCdgh[1]), msg1[0], msg1[1]);
+        
+        msg0[2] = pad0;
+        msg0[3] = pad1;
+        msg1[2] = pad0;
+        msg1[3] = pad1;
+        abef0 = outerAbef[0];
+        cdgh0 = outerCdgh[0];
+        abef1 = outerAbef[1];
+        cdgh1 = outerCdgh[1];
+        sha256RoundsShaNi2(abef0, cdgh0, msg0, abef1, cdgh1, msg1);
+        fromShaNiState(_mm_add_epi32(abef0, outerAbef[0]), _mm_add_epi32(cdgh0, outerCdgh[0]), u[0][0], u[0][1]);
+        fromShaNiState(_mm_add_epi32(abef1, outerAbef[1]), _mm_add_epi32(cdgh1, outerCdgh[1]), u[1][0], u[1][1]);
+        
+        for (int l = 0; l < 2; l++) {
+            t[l][0] = _mm_xor_si128(t[l][0], u[l][0]);
+            t[l][1] = _mm_xor_si128(t[l][1], u[l][1]);
+        }
+    }
+    
+    for (int l = 0; l < 2; l++) {
+        for (int i = 0; i < 2; i++) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes[l].u + i * 4), u[l][i]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes[l].t + i * 4), t[l][i]);
+        }
+    }
+}
+
+SIMD_TARGET("avx2")
+static inline __m256i rotr8(__m256i x, int n) {
+    return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+}
+
+// One compression per lane: state[i] holds word i of all eight lanes, and the
+// message is the eight words in first followed by the fixed iteration padding
+SIMD_TARGET("avx2")
+static inline void sha256Compress8(__m256i state[8], const __m256i first[8]) {
+    __m256i w[64];
+    for (int i = 0; i < 8; i++) {
+        w[i] = first[i];
+    }
+    w[8] = _mm256_set1_epi32(static_cast<int>(SHA256_PAD_WORD));
+    for (int i = 9; i < 15; i++) {
+        w[i] = _mm256_setzero_si256();
+    }
+    w[15] = _mm256_set1_epi32(static_cast<int>(ITERATION_MESSAGE_BITS));
+    for (int i = 16; i < 64; i++) {
+        const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rotr8(w[i - 15], 7), rotr8(w[i - 15], 18)),
+                                            _mm256_srli_epi32(w[i - 15], 3));
+        const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rotr8(w[i - 2], 17), rotr8(w[i - 2], 19)),
+                                            _mm256_srli_epi32(w[i - 2], 10));
+        w[i] = _mm256_add_epi32(_mm256_add_epi32(w[i - 16], s0), _mm256_add_epi32(w[i - 7], s1));
+    }
+    
+    __m256i a = state[0], b = state[1], c = state[2], d = state[3];
+    __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; i++) {
+        const __m256i sigma1 = _mm256_xor_si256(_mm256_xor_si256(rotr8(e, 6), rotr8(e, 11)), rotr8(e, 25));
+        const __m256i choose = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        const __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, sigma1),
+                                            _mm256_add_epi32(choose, _mm256_add_epi32(
+                                                _mm256_set1_epi32(static_cast<int>(SHA256_K[i])), w[i])));
+        const __m256i sigma0 = _mm256_xor_si256(_mm256_xor_si256(rotr8(a, 2), rotr8(a, 13)), rotr8(a, 22));
+        const __m256i majority = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+        h = g;
+        g = f;
+        f = e;
+        e = _mm256_add_epi32(d, t1);
+        d = c;
+        c = b;
+        b = a;
+        a = _mm256_add_epi32(t1, _mm256_add_epi32(sigma0, majority));
+    }
+    
+    state[0] = _mm256_add_epi32(state[0], a);
+    state[1] = _mm256_add_epi32(state[1], b);
+    state[2] = _mm256_add_epi32(state[2], c);
+    state[3] = _mm256_add_epi32(state[3], d);
+    state[4] = _mm256_add_epi32(state[4], e);
+    state[5] = _mm256_add_epi32(state[5], f);
+    state[6] = _mm256_add_epi32(state[6], g);
+    state[7] = _mm256_add_epi32(state[7], h);
+}
+
+SIMD_TARGET("avx2")
+static void pbkdf2RoundsAvx2(Pbkdf2Lane* lanes, uint32_t rounds) {
+    // Transpose to one vector per state word, lane l in element l
+    __m256i inner[8], outer[8], u[8], t[8];
+    for (int i = 0; i < 8; i++) {
+        inner[i] = _mm256_setr_epi32(lanes[0].inner[i], lanes[1].inner[i], lanes[2].inner[i], lanes[3].inner[i],
+                                     lanes[4].inner[i], lanes[5].inner[i], lanes[6].inner[i], lanes[7].inner[i]);
+        outer[i] = _mm256_setr_epi32(lanes[0].outer[i], lanes[1].outer[i], lanes[2].outer[i], lanes[3].outer[i],
+                                     lanes[4].outer[i], lanes[5].outer[i], lanes[6].outer[i], lanes[7].outer[i]);
+        u[i] = _mm256_setr_epi32(lanes[0].u[i], lanes[1].u[i], lanes[2].u[i], lanes[3].u[i],
+                                 lanes[4].u[i], lanes[5].u[i], lanes[6].u[i], lanes[7].u[i]);
+        t[i] = _mm256_setr_epi32(lanes[0].t[i], lanes[1].t[i], lanes[2].t[i], lanes[3].t[i],
+                                 lanes[4].t[i], lanes[5].t[i], lanes[6].t[i], lanes[7].t[i]);
+    }
+    
+    for (uint32_t r = 0; r < rounds; r++) {
+        __m256i state[8];
+        memcpy(state, inner, sizeof(state));
+        sha256Compress8(state, u);
+        memcpy(u, outer, sizeof(u));
+        sha256Compress8(u, state);
+        for (int i = 0; i < 8; i++) {
+            t[i] = _mm256_xor_si256(t[i], u[i]);
+        }
+    }
+    
+    for (int i = 0; i < 8; i++) {
+        uint32_t uWords[8], tWords[8];
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(uWords), u[i]);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(tWords), t[i]);
+        for (int l = 0; l < 8; l++) {
+            lanes[l].u[i] = uWords[l];
+            lanes[l].t[i] = tWords[l];
+        }
+    }
+}
+#endif
+
+// Without a multi-lane kernel each job goes to OpenSSL, whose single-buffer
+// SHA-256 is already as fast as a portable one-lane loop could be
+struct Pbkdf2Engine {
+    Pbkdf2Kernel kernel;
+    size_t lanes;
+    size_t minLanes; // fewer real lanes than this in a group are cheaper through OpenSSL
+};
+
+static Pbkdf2Engine selectPbkdf2Engine() {
+    Pbkdf2Engine engine = {nullptr, 1, 1};
+#ifdef ENC_DEC_X86_SIMD
+    if (cpuFeatures().sha && cpuFeatures().sse41) {
+        engine.kernel = pbkdf2RoundsShaNi;
+        engine.lanes = 2;
+    } else if (cpuFeatures().avx2) {
+        // One AVX2 lane runs at about 2.5x the cost of an OpenSSL derivation
+        engine.kernel = pbkdf2RoundsAvx2;
+        engine.lanes = 8;
+        engine.minLanes = 3;
+    }
+#endif
+    return engine;
+}
+
+static void opensslPbkdf2(const Pbkdf2Job& job, size_t keyLength, string& key) {
+    key.assign(keyLength, '\0');
+    if (PKCS5_PBKDF2_HMAC(job.password.data(), static_cast<int>(job.password.length()),
+                          reinterpret_cast<const unsigned char*>(job.salt.data()),
+                          static_cast<int>(job.salt.length()), static_cast<int>(job.iterations),
+                          EVP_sha256(), static_cast<int>(keyLength),
+                          reinterpret_cast<unsigned char*>(&key[0])) != 1) {
+        key.clear();
+    }
+}
+
+vector<string> pbkdf2Batch(const vector<Pbkdf2Job>& jobs, size_t keyLength, unsigned threads) {
+    static const Pbkdf2Engine engine = selectPbkdf2Engine();
+    vector<string> keys(jobs.size());
+    if (keyLength == 0) {
+        return keys;
+    }
+    
+    if (engine.kernel == nullptr) {
+        runWorkers(jobs.size(), threads, [&](size_t j) {
+            if (jobs[j].iterations != 0) {
+                opensslPbkdf2(jobs[j], keyLength, keys[j]);
+            }
+        });
+        return keys;
+    }
+    
+    // Every 32-byte output block is its own lane; lanes sharing an iteration
+    // count are grouped, and a short last group is padded with a copy of its first
+    // lane. A last group with fewer than minLanes real lanes goes to OpenSSL instead,
+    // whole jobs at a time.
+    const size_t blocksPerKey = (keyLength + 31) / 32;
+    vector<Pbkdf2Lane> lanes;
+    lanes.reserve(jobs.size() * blocksPerKey);
+    for (size_t j = 0; j < jobs.size(); j++) {
+        if (jobs[j].iterations == 0) {
+            continue;
+        }
+        for (size_t b = 0; b < blocksPerKey; b++) {
+            lanes.push_back(Pbkdf2Lane());
+            prepareLane(jobs[j], j, b, lanes.back());
+        }
+    }
+    stable_sort(lanes.begin(), lanes.end(), [](const Pbkdf2Lane& x, const Pbkdf2Lane& y) {
+        return x.iterations < y.iterations;
+    });
+    
+    vector<Pbkdf2Lane> grouped;
+    grouped.reserve(lanes.size() + engine.lanes * 4);
+    vector<char> viaOpenssl(jobs.size(), 0);
+    for (size_t begin = 0; begin < lanes.size();) {
+        size_t end = begin;
+        while (end < lanes.size() && lanes[end].iterations == lanes[begin].iterations) {
+            end++;
+        }
+        const size_t tail = (end - begin) % engine.lanes;
+        const size_t kept = tail != 0 && tail < engine.minLanes ? end - tail : end;
+        for (size_t i = kept; i < end; i++) {
+            viaOpenssl[lanes[i].job] = 1;
+        }
+        grouped.insert(grouped.end(), lanes.begin() + begin, lanes.begin() + kept);
+        for (size_t filled = kept - begin; filled % engine.lanes != 0; filled++) {
+            grouped.push_back(lanes[begin]);
+            grouped.back().job = jobs.size(); // filler, never copied out
+        }
+        begin = end;
+    }
+    OPENSSL_cleanse(lanes.data(), lanes.size() * sizeof(Pbkdf2Lane));
+    
+    vector<size_t> fallback;
+    for (size_t j = 0; j < jobs.size(); j++) {
+        if (viaOpenssl[j]) {
+            fallback.push_back(j);
+        } else if (jobs[j].iterations != 0) {
+            keys[j].assign(keyLength, '\0');
+        }
+    }
+    
+    const size_t groups = grouped.size() / engine.lanes;
+    runWorkers(groups + fallback.size(), threads, [&](size_t g) {
+        if (g >= groups) {
+            opensslPbkdf2(jobs[fallback[g - groups]], keyLength, keys[fallback[g - groups]]);
+            return;
+        }
+        Pbkdf2Lane* group = grouped.data() + g * engine.lanes;
+        engine.kernel(group, group[0].iterations - 1);
+    });
+    
+    for (const auto& lane : grouped) {
+        // A job split across a full group and the OpenSSL tail keeps the OpenSSL key
+        if (lane.job >= jobs.size() || viaOpenssl[lane.job]) {
+            continue;
+        }
+        unsigned char block[32];
+        for (int i = 0; i < 8; i++) {
+            storeBigEndian32(block + i * 4, lane.t[i]);
+        }
+        const size_t offset = lane.block * 32;
+        memcpy(&keys[lane.job][offset], block, min<size_t>(32, keyLength - offset));
+        OPENSSL_cleanse(block, sizeof(block));
+    }
+    OPENSSL_cleanse(grouped.data(), grouped.size() * sizeof(Pbkdf2Lane));
+    
+    return keys;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// PBKDF2-HMAC-SHA256 for many passwords at once. After the HMAC pads are
+// hashed, every iteration is two single-block SHA-256 compressions of fixed
+// shape, so independent derivations run side by side: two interleaved lanes
+// with SHA-NI, eight lanes with AVX2, one otherwise. Lane groups are spread
+// over worker threads; jobs too few to fill an AVX2 group go to OpenSSL.
+// Output matches PKCS5_PBKDF2_HMAC with SHA-256.
+const size_t PBKDF2_BATCH_CHUNK = 64; // Images whose keys batch callers derive together
+
+struct Pbkdf2Job {
+    std::string password;
+    std::string salt;
+    uint32_t iterations;
+};
+
+// Returns one keyLength-byte key per job, in job order (empty for jobs with 0 iterations).
+// threads = 0 uses one worker per CPU core.
+std::vector<std::string> pbkdf2Batch(const std::vector<Pbkdf2Job>& jobs, size_t keyLength, unsigned threads = 0);
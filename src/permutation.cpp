@@ -0,0 +1,55 @@
+#include "permutation.h"
+
+using namespace std;
+
+namespace {
+
+// SplitMix64 finalizer, used both to expand the seed and as the round function
+uint64_t mix64(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+}
+
+IndexPermutation::IndexPermutation(size_t size, unsigned seed)
+    : domainSize(size), halfBits(1) {
+    // Smallest even bit width whose range covers the domain
+    while (halfBits < 32 && (static_cast<uint64_t>(1) << (2 * halfBits)) < size) {
+        halfBits++;
+    }
+    halfMask = (static_cast<uint64_t>(1) << halfBits) - 1;
+    
+    uint64_t state = seed;
+    for (int r = 0; r < FEISTEL_ROUNDS; r++) {
+        state += 0x9e3779b97f4a7c15ULL;
+        roundKeys[r] = mix64(state);
+    }
+}
+
+uint64_t IndexPermutation::encryptBlock(uint64_t value) const {
+    uint64_t left = value >> halfBits;
+    uint64_t right = value & halfMask;
+    
+    for (int r = 0; r < FEISTEL_ROUNDS; r++) {
+        const uint64_t next = left ^ (mix64(right ^ roundKeys[r]) & halfMask);
+        left = right;
+        right = next;
+    }
+    
+    return (left << halfBits) | right;
+}
+
+size_t IndexPermutation::operator()(size_t index) const {
+    // Cycle-walk: the block range is at most 4x the domain, so this terminates quickly
+    uint64_t value = index;
+    do {
+        value = encryptBlock(value);
+    } while (value >= domainSize);
+    
+    return static_cast<size_t>(value);
+}
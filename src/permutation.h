@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+const int FEISTEL_ROUNDS = 6;
+
+// Keyed pseudo-random permutation of [0, size), evaluated one index at a time.
+// A balanced Feistel network over the next even power of two is cycle-walked
+// until the result falls back inside the domain, so no index table is needed.
+class IndexPermutation {
+public:
+    IndexPermutation(size_t size, unsigned seed);
+    
+    size_t operator()(size_t index) const;
+    size_t size() const { return domainSize; }
+    
+private:
+    uint64_t encryptBlock(uint64_t value) const;
+    
+    size_t domainSize;
+    unsigned halfBits;
+    uint64_t halfMask;
+    uint64_t roundKeys[FEISTEL_ROUNDS];
+};
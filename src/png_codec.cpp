@@ -0,0 +1,422 @@
+#include "png_codec.h"
+#include "checksum.h"
+#include "worker_pool.h"
+#include <cstdlib>
+#include <climits>
+#include <algorithm>
+
+#if defined(ENC_DEC_WITH_LIBDEFLATE)
+#include <libdeflate.h>
+#elif defined(ENC_DEC_WITH_ZLIB)
+#include <zlib.h>
+#endif
+
+using namespace std;
+
+// Deflate levels per profile (Fastest, Balanced, Smallest) for the external backends
+#if defined(ENC_DEC_WITH_LIBDEFLATE)
+static const int PROFILE_DEFLATE_LEVELS[3] = {1, 6, 12};
+#else
+static const int PROFILE_DEFLATE_LEVELS[3] = {1, 6, 9};
+#endif
+
+// Smallest skips matches shorter than this; the zlib backend gets the same effect from Z_FILTERED
+const unsigned SMALLEST_MIN_MATCH = 6;
+
+static PngEncodeProfile currentProfile = PngEncodeProfile::Balanced;
+static unsigned currentEncodeThreads = 0;
+
+#if defined(ENC_DEC_WITH_LIBDEFLATE) || defined(ENC_DEC_WITH_ZLIB)
+// The level travels to the backend through custom_context; without one, use Balanced
+static int deflateLevel(const LodePNGCompressSettings* settings) {
+    const int* level = static_cast<const int*>(settings->custom_context);
+    return level != nullptr ? *level : PROFILE_DEFLATE_LEVELS[1];
+}
+#endif
+
+#if defined(ENC_DEC_WITH_LIBDEFLATE)
+
+// Buffers handed back to lodepng must come from malloc, since lodepng frees them
+static unsigned libdeflateCompress(unsigned char** out, size_t* outsize,
+                                   const unsigned char* in, size_t insize,
+                                   const LodePNGCompressSettings* settings) {
+    libdeflate_compressor* compressor = libdeflate_alloc_compressor(deflateLevel(settings));
+    if (compressor == nullptr) {
+        return 1;
+    }
+    
+    const size_t bound = libdeflate_zlib_compress_bound(compressor, insize);
+    unsigned char* buffer = static_cast<unsigned char*>(malloc(bound));
+    if (buffer == nullptr) {
+        libdeflate_free_compressor(compressor);
+        return 1;
+    }
+    
+    const size_t written = libdeflate_zlib_compress(compressor, in, insize, buffer, bound);
+    libdeflate_free_compressor(compressor);
+    
+    if (written == 0) {
+        free(buffer);
+        return 1;
+    }
+    
+    free(*out);
+    *out = buffer;
+    *outsize = written;
+    return 0;
+}
+
+static unsigned libdeflateDecompress(unsigned char** out, size_t* outsize,
+                                     const unsigned char* in, size_t insize,
+                                     const LodePNGDecompressSettings* settings) {
+    libdeflate_decompressor* decompressor = libdeflate_alloc_decompressor();
+    if (decompressor == nullptr) {
+        return 1;
+    }
+    
+    // The output size is unknown up front; grow until libdeflate has enough room
+    size_t capacity = insize * 4 + 1024;
+    unsigned char* buffer = nullptr;
+    size_t produced = 0;
+    libdeflate_result result = LIBDEFLATE_INSUFFICIENT_SPACE;
+    
+    while (result == LIBDEFLATE_INSUFFICIENT_SPACE) {
+        if (settings->max_output_size && capacity > settings->max_output_size * 2) {
+            break;
+        }
+        unsigned char* grown = static_cast<unsigned char*>(realloc(buffer, capacity));
+        if (grown == nullptr) {
+            break;
+        }
+        buffer = grown;
+        result = libdeflate_zlib_decompress(decompressor, in, insize, buffer, capacity, &produced);
+        capacity *= 2;
+    }
+    libdeflate_free_decompressor(decompressor);
+    
+    if (result != LIBDEFLATE_SUCCESS) {
+        free(buffer);
+        return 1;
+    }
+    
+    free(*out);
+    *out = buffer;
+    *outsize = produced;
+    return 0;
+}
+
+#elif defined(ENC_DEC_WITH_ZLIB)
+
+// Filtered images at least twice this size are deflated in segments on several threads
+const size_t DEFLATE_SEGMENT_SIZE = 256 * 1024;
+const size_t DEFLATE_WINDOW_SIZE = 32768;
+
+// Raw deflate of in[begin, end), primed with the window before it so matches
+// still reach back across the segment boundary. All but the last segment end
+// with a sync flush, which byte-aligns the output without a final block, so
+// the segments concatenate into one deflate stream.
+static bool deflateSegment(const unsigned char* in, size_t begin, size_t end, bool last, int level, int strategy,
+                           vector<unsigned char>& out) {
+    z_stream stream = z_stream();
+    if (deflateInit2(&stream, level, Z_DEFLATED, -15, 8, strategy) != Z_OK) {
+        return false;
+    }
+    
+    const size_t window = min(begin, DEFLATE_WINDOW_SIZE);
+    bool ok = window == 0 || deflateSetDictionary(&stream, in + begin - window, static_cast<uInt>(window)) == Z_OK;
+    
+    // The bound covers a finished stream; a sync flush adds at most an empty stored block
+    out.resize(deflateBound(&stream, static_cast<uLong>(end - begin)) + 16);
+    stream.next_in = const_cast<Bytef*>(in + begin);
+    stream.avail_in = static_cast<uInt>(end - begin);
+    stream.next_out = out.data();
+    stream.avail_out = static_cast<uInt>(out.size());
+    if (ok) {
+        const int status = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+        ok = last ? status == Z_STREAM_END : status == Z_OK && stream.avail_in == 0;
+    }
+    out.resize(out.size() - stream.avail_out);
+    deflateEnd(&stream);
+    return ok;
+}
+
+// pigz-style parallel zlib stream: segments are deflated independently, and
+// their Adler-32s are merged with adler32_combine for the trailer
+static unsigned zlibCompressParallel(unsigned char** out, size_t* outsize,
+                                     const unsigned char* in, size_t insize, int level, int strategy,
+                                     unsigned threads) {
+    const size_t count = (insize + DEFLATE_SEGMENT_SIZE - 1) / DEFLATE_SEGMENT_SIZE;
+    vector<vector<unsigned char>> segments(count);
+    vector<uLong> checksums(count);
+    vector<char> done(count, 0);
+    
+    runWorkers(count, threads, [&](size_t i) {
+        const size_t begin = i * DEFLATE_SEGMENT_SIZE;
+        const size_t end = min(insize, begin + DEFLATE_SEGMENT_SIZE);
+        done[i] = deflateSegment(in, begin, end, i + 1 == count, level, strategy, segments[i]);
+        checksums[i] = adler32Update(1, in + begin, end - begin);
+    });
+    
+    size_t total = 6;
+    uLong checksum = 1;
+    for (size_t i = 0; i < count; i++) {
+        if (!done[i]) {
+            return 1;
+        }
+        const size_t length = min(DEFLATE_SEGMENT_SIZE, insize - i * DEFLATE_SEGMENT_SIZE);
+        checksum = adler32_combine(checksum, checksums[i], static_cast<z_off_t>(length));
+        total += segments[i].size();
+    }
+    
+    unsigned char* buffer = static_cast<unsigned char*>(malloc(total));
+    if (buffer == nullptr) {
+        return 1;
+    }
+    
+    // zlib header: deflate with a 32K window, FLEVEL as zlib would set it for this level
+    const unsigned flevel = level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+    const unsigned header = (0x78u << 8) | (flevel << 6);
+    buffer[0] = 0x78;
+    buffer[1] = static_cast<unsigned char>((flevel << 6) + (31 - header % 31));
+    
+    size_t position = 2;
+    for (const auto& segment : segments) {
+        copy(segment.begin(), segment.end(), buffer + position);
+        position += segment.size();
+    }
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        buffer[position++] = static_cast<unsigned char>((checksum >> shift) & 0xFF);
+    }
+    
+    free(*out);
+    *out = buffer;
+    *outsize = total;
+    return 0;
+}
+
+// Z_FILTERED drops matches of five bytes or less, which is what a lodepng minmatch above 5 asks for
+static int deflateStrategy(const LodePNGCompressSettings* settings) {
+    return settings->minmatch > 5 ? Z_FILTERED : Z_DEFAULT_STRATEGY;
+}
+
+static unsigned zlibCompress(unsigned char** out, size_t* outsize,
+                             const unsigned char* in, size_t insize,
+                             const LodePNGCompressSettings* settings) {
+    const unsigned threads = currentEncodeThreads != 0 ? currentEncodeThreads : thread::hardware_concurrency();
+    if (threads > 1 && insize >= 2 * DEFLATE_SEGMENT_SIZE) {
+        return zlibCompressParallel(out, outsize, in, insize, deflateLevel(settings), deflateStrategy(settings),
+                                    threads);
+    }
+    
+    z_stream stream = z_stream();
+    if (deflateInit2(&stream, deflateLevel(settings), Z_DEFLATED, 15, 8, deflateStrategy(settings)) != Z_OK) {
+        return 1;
+    }
+    
+    const size_t bound = deflateBound(&stream, static_cast<uLong>(insize));
+    unsigned char* buffer = static_cast<unsigned char*>(malloc(bound));
+    int status = buffer == nullptr ? Z_MEM_ERROR : Z_OK;
+    
+    // Feed input and output in chunks that fit zlib's 32-bit counters
+    size_t consumed = 0;
+    size_t produced = 0;
+    while (status == Z_OK) {
+        const uInt chunkIn = static_cast<uInt>(min(insize - consumed, static_cast<size_t>(UINT_MAX)));
+        const uInt chunkOut = static_cast<uInt>(min(bound - produced, static_cast<size_t>(UINT_MAX)));
+        stream.next_in = const_cast<Bytef*>(in + consumed);
+        stream.avail_in = chunkIn;
+        stream.next_out = buffer + produced;
+        stream.avail_out = chunkOut;
+        
+        status = deflate(&stream, consumed + chunkIn == insize ? Z_FINISH : Z_NO_FLUSH);
+        consumed += chunkIn - stream.avail_in;
+        produced += chunkOut - stream.avail_out;
+    }
+    deflateEnd(&stream);
+    
+    if (status != Z_STREAM_END) {
+        free(buffer);
+        return 1;
+    }
+    
+    free(*out);
+    *out = buffer;
+    *outsize = produced;
+    return 0;
+}
+
+static unsigned zlibDecompress(unsigned char** out, size_t* outsize,
+                               const unsigned char* in, size_t insize,
+                               const LodePNGDecompressSettings* settings) {
+    z_stream stream = z_stream();
+    if (inflateInit(&stream) != Z_OK) {
+        return 1;
+    }
+    
+    size_t capacity = insize * 4 + 1024;
+    unsigned char* buffer = static_cast<unsigned char*>(malloc(capacity));
+    size_t produced = 0;
+    int status = buffer == nullptr ? Z_MEM_ERROR : Z_OK;
+    
+    stream.next_in = const_cast<Bytef*>(in);
+    
+    // Feed input and output in chunks that fit zlib's 32-bit counters
+    size_t remaining = insize;
+    while (status == Z_OK) {
+        if (produced == capacity) {
+            if (settings->max_output_size && produced > settings->max_output_size) {
+                status = Z_BUF_ERROR;
+                break;
+            }
+            capacity *= 2;
+            unsigned char* grown = static_cast<unsigned char*>(realloc(buffer, capacity));
+            if (grown == nullptr) {
+                status = Z_MEM_ERROR;
+                break;
+            }
+            buffer = grown;
+        }
+        
+        const uInt chunkIn = static_cast<uInt>(min(remaining, static_cast<size_t>(UINT_MAX)));
+        const uInt chunkOut = static_cast<uInt>(min(capacity - produced, static_cast<size_t>(UINT_MAX)));
+        stream.avail_in = chunkIn;
+        stream.next_out = buffer + produced;
+        stream.avail_out = chunkOut;
+        
+        status = inflate(&stream, Z_NO_FLUSH);
+        remaining -= chunkIn - stream.avail_in;
+        produced += chunkOut - stream.avail_out;
+        
+        // Z_BUF_ERROR with output space left means the input ended early
+        if (status == Z_BUF_ERROR && stream.avail_out == 0) {
+            status = Z_OK;
+        }
+    }
+    inflateEnd(&stream);
+    
+    if (status != Z_STREAM_END) {
+        free(buffer);
+        return 1;
+    }
+    
+    free(*out);
+    *out = buffer;
+    *outsize = produced;
+    return 0;
+}
+
+#endif
+
+void configurePngState(lodepng::State& state) {
+#if defined(ENC_DEC_WITH_LIBDEFLATE)
+    state.encoder.zlibsettings.custom_zlib = libdeflateCompress;
+    state.decoder.zlibsettings.custom_zlib = libdeflateDecompress;
+#elif defined(ENC_DEC_WITH_ZLIB)
+    state.encoder.zlibsettings.custom_zlib = zlibCompress;
+    state.decoder.zlibsettings.custom_zlib = zlibDecompress;
+#else
+    (void)state;
+#endif
+}
+
+const char* pngBackendName() {
+#if defined(ENC_DEC_WITH_LIBDEFLATE)
+    return "libdeflate";
+#elif defined(ENC_DEC_WITH_ZLIB)
+    return "zlib";
+#else
+    return "lodepng";
+#endif
+}
+
+void applyPngEncodeProfile(lodepng::State& state, PngEncodeProfile profile) {
+    LodePNGEncoderSettings& encoder = state.encoder;
+    
+    // The header bytes in the alpha channel always force RGBA8, so auto_convert's
+    // color counting pass would never find a smaller mode
+    switch (profile) {
+        case PngEncodeProfile::Fastest:
+            encoder.filter_strategy = LFS_ZERO;
+            encoder.zlibsettings.btype = 2;
+            encoder.zlibsettings.windowsize = 2048;
+            encoder.zlibsettings.lazymatching = 0;
+            encoder.zlibsettings.fastmatch = 1; // built-in deflate only: single probe instead of hash chains
+            encoder.auto_convert = 0;
+            break;
+        case PngEncodeProfile::Balanced:
+            encoder.filter_strategy = LFS_MINSUM;
+            encoder.zlibsettings.btype = 2;
+            encoder.zlibsettings.windowsize = 2048;
+            encoder.zlibsettings.lazymatching = 1;
+            encoder.auto_convert = 0;
+            break;
+        case PngEncodeProfile::Smallest:
+            encoder.filter_strategy = LFS_MINSUM;
+            encoder.zlibsettings.btype = 2;
+            encoder.zlibsettings.windowsize = 32768;
+            encoder.zlibsettings.nicematch = 258;
+            // The noisy cover makes short matches cost more than the literals they replace
+            encoder.zlibsettings.minmatch = SMALLEST_MIN_MATCH;
+            encoder.zlibsettings.lazymatching = 1;
+            encoder.auto_convert = 0;
+            break;
+    }
+    
+    encoder.zlibsettings.custom_context = &PROFILE_DEFLATE_LEVELS[static_cast<int>(profile)];
+}
+
+bool parsePngEncodeProfile(const string& name, PngEncodeProfile& profile) {
+    if (name == "fastest") {
+        profile = PngEncodeProfile::Fastest;
+    } else if (name == "balanced") {
+        profile = PngEncodeProfile::Balanced;
+    } else if (name == "smallest") {
+        profile = PngEncodeProfile::Smallest;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void setPngEncodeProfile(PngEncodeProfile profile) {
+    currentProfile = profile;
+}
+
+PngEncodeProfile pngEncodeProfile() {
+    return currentProfile;
+}
+
+void setPngEncodeThreads(unsigned threads) {
+    currentEncodeThreads = threads;
+}
+
+unsigned pngEncodeThreads() {
+    return currentEncodeThreads;
+}
+
+unsigned encodePng(const string& filename, const vector<unsigned char>& image,
+                   unsigned width, unsigned height) {
+    lodepng::State state;
+    configurePngState(state);
+    applyPngEncodeProfile(state, currentProfile);
+    
+    vector<unsigned char> buffer;
+    unsigned error = lodepng::encode(buffer, image, width, height, state);
+    if (error) {
+        return error;
+    }
+    return lodepng::save_file(buffer, filename);
+}
+
+unsigned decodePng(vector<unsigned char>& image, unsigned& width, unsigned& height,
+                   const string& filename) {
+    vector<unsigned char> buffer;
+    unsigned error = lodepng::load_file(buffer, filename);
+    if (error) {
+        return error;
+    }
+    
+    lodepng::State state;
+    configurePngState(state);
+    return lodepng::decode(image, width, height, state, buffer);
+}
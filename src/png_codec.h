@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include "../Include/lodepng.h"
+
+// Route lodepng's zlib stage through libdeflate or the system zlib when the
+// build found one (ENC_DEC_WITH_LIBDEFLATE / ENC_DEC_WITH_ZLIB); otherwise the
+// built-in lodepng deflate/inflate is left in place.
+void configurePngState(lodepng::State& state);
+const char* pngBackendName();
+
+// Encode presets trading file size for write throughput
+enum class PngEncodeProfile {
+    Fastest,  // no filter trials, small window, greedy matching, fast deflate level
+    Balanced, // lodepng defaults (minsum filters, 2048 window, lazy matching)
+    Smallest  // minsum filters, full 32K window, no matches under 6 bytes (Z_FILTERED), strongest deflate level
+};
+
+void applyPngEncodeProfile(lodepng::State& state, PngEncodeProfile profile);
+bool parsePngEncodeProfile(const std::string& name, PngEncodeProfile& profile);
+
+// Profile used by encodePng; Balanced unless changed
+void setPngEncodeProfile(PngEncodeProfile profile);
+PngEncodeProfile pngEncodeProfile();
+
+// Threads deflating one image with the zlib backend (0 = one per core). Large
+// images are split into segments whose streams are joined into one zlib stream.
+void setPngEncodeThreads(unsigned threads);
+unsigned pngEncodeThreads();
+
+unsigned encodePng(const std::string& filename, const std::vector<unsigned char>& image,
+                   unsigned width, unsigned height);
+unsigned decodePng(std::vector<unsigned char>& image, unsigned& width, unsigned& height,
+                   const std::string& filename);
@@ -0,0 +1,241 @@
+#include "png_filter.h"
+#include "cpu_features.h"
+#include "../Include/lodepng.h"
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+
+#ifdef ENC_DEC_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+const size_t PIXEL_BYTES = 4;
+
+typedef unsigned (*UnfilterKernel)(unsigned char*, const unsigned char*, const unsigned char*, size_t, unsigned char);
+
+static unsigned char paethPredictor(int a, int b, int c) {
+    const int pa = abs(b - c);
+    const int pb = abs(a - c);
+    const int pc = abs(a + b - 2 * c);
+    if (pc < pa && pc < pb) return static_cast<unsigned char>(c);
+    if (pb < pa) return static_cast<unsigned char>(b);
+    return static_cast<unsigned char>(a);
+}
+
+// Byte-by-byte reference; the SIMD kernels finish their scanline tails with it from offset start
+static void unfilterTail(unsigned char* out, const unsigned char* in, const unsigned char* previous,
+                         size_t start, size_t length, unsigned char filterType) {
+    for (size_t i = start; i < length; i++) {
+        const int left = i >= PIXEL_BYTES ? out[i - PIXEL_BYTES] : 0;
+        const int upLeft = i >= PIXEL_BYTES ? previous[i - PIXEL_BYTES] : 0;
+        switch (filterType) {
+            case 1: out[i] = static_cast<unsigned char>(in[i] + left); break;
+            case 2: out[i] = static_cast<unsigned char>(in[i] + previous[i]); break;
+            case 3: out[i] = static_cast<unsigned char>(in[i] + ((left + previous[i]) >> 1)); break;
+            case 4: out[i] = static_cast<unsigned char>(in[i] + paethPredictor(left, previous[i], upLeft)); break;
+        }
+    }
+}
+
+static unsigned unfilterScalar(unsigned char* out, const unsigned char* in, const unsigned char* previous,
+                               size_t length, unsigned char filterType) {
+    if (filterType > 4) {
+        return 36; // illegal PNG filter type
+    }
+    if (filterType == 0) {
+        if (out != in) memcpy(out, in, length);
+        return 0;
+    }
+    unfilterTail(out, in, previous, 0, length, filterType);
+    return 0;
+}
+
+#ifdef ENC_DEC_X86_SIMD
+// Sub is a running sum of pixels: two shifted adds give the prefix sum of four
+// pixels, then the last pixel of the previous block is added to all of them
+SIMD_TARGET("sse2")
+static size_t unfilterSubSse2(unsigned char* out, const unsigned char* in, size_t length) {
+    __m128i last = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi8(x, last);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), x);
+        last = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    return i;
+}
+
+SIMD_TARGET("sse2")
+static size_t unfilterUpSse2(unsigned char* out, const unsigned char* in, const unsigned char* previous,
+                             size_t length) {
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        const __m128i up = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_add_epi8(x, up));
+    }
+    return i;
+}
+
+// Average and Paeth depend on the pixel just reconstructed, so each 16-byte
+// block is walked one pixel at a time inside the register: the inputs shift
+// down by a pixel per step and finished pixels rotate into the result.
+SIMD_TARGET("sse4.1")
+static size_t unfilterAverageSse41(unsigned char* out, const unsigned char* in, const unsigned char* previous,
+                                   size_t length) {
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i left = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i up = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i));
+        __m128i row = _mm_setzero_si128();
+        for (int pixel = 0; pixel < 4; pixel++) {
+            // pavgb rounds up; dropping the low bit of odd sums gives the floor PNG wants
+            const __m128i average = _mm_sub_epi8(_mm_avg_epu8(left, up), _mm_and_si128(_mm_xor_si128(left, up), one));
+            left = _mm_add_epi8(x, average);
+            row = _mm_alignr_epi8(left, row, 4);
+            x = _mm_srli_si128(x, 4);
+            up = _mm_srli_si128(up, 4);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), row);
+    }
+    return i;
+}
+
+// Paeth in 16-bit lanes: pick a (left), b (up) or c (up-left), whichever is
+// closest to a + b - c, preferring a, then b on ties
+SIMD_TARGET("sse4.1")
+static size_t unfilterPaethSse41(unsigned char* out, const unsigned char* in, const unsigned char* previous,
+                                 size_t length) {
+    __m128i left = _mm_setzero_si128();
+    __m128i upLeft = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i upRow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(previous + i));
+        __m128i row = _mm_setzero_si128();
+        for (int pixel = 0; pixel < 4; pixel++) {
+            const __m128i up = _mm_cvtepu8_epi16(upRow);
+            __m128i pa = _mm_sub_epi16(up, upLeft);
+            __m128i pb = _mm_sub_epi16(left, upLeft);
+            const __m128i pc = _mm_abs_epi16(_mm_add_epi16(pa, pb));
+            pa = _mm_abs_epi16(pa);
+            pb = _mm_abs_epi16(pb);
+            const __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            __m128i nearest = _mm_blendv_epi8(upLeft, up, _mm_cmpeq_epi16(smallest, pb));
+            nearest = _mm_blendv_epi8(nearest, left, _mm_cmpeq_epi16(smallest, pa));
+            
+            const __m128i pixelBytes = _mm_add_epi8(x, _mm_packus_epi16(nearest, nearest));
+            row = _mm_alignr_epi8(pixelBytes, row, 4);
+            left = _mm_cvtepu8_epi16(pixelBytes);
+            upLeft = up;
+            x = _mm_srli_si128(x, 4);
+            upRow = _mm_srli_si128(upRow, 4);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), row);
+    }
+    return i;
+}
+
+SIMD_TARGET("sse4.1")
+static unsigned unfilterSse41(unsigned char* out, const unsigned char* in, const unsigned char* previous,
+                              size_t length, unsigned char filterType) {
+    size_t done = 0;
+    switch (filterType) {
+        case 0: return unfilterScalar(out, in, previous, length, filterType);
+        case 1: done = unfilterSubSse2(out, in, length); break;
+        case 2: done = unfilterUpSse2(out, in, previous, length); break;
+        case 3: done = unfilterAverageSse41(out, in, previous, length); break;
+        case 4: done = unfilterPaethSse41(out, in, previous, length); break;
+        default: return 36; // illegal PNG filter type
+    }
+    unfilterTail(out, in, previous, done, length, filterType);
+    return 0;
+}
+
+// The in-lane prefix sum covers four pixels; the low lane's last pixel is then
+// carried into the high lane, and the previous block's last pixel into both
+SIMD_TARGET("avx2")
+static size_t unfilterSubAvx2(unsigned char* out, const unsigned char* in, size_t length) {
+    const __m256i lastIndex = _mm256_set1_epi32(7);
+    __m256i last = _mm256_setzero_si256();
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        x = _mm256_add_epi8(x, _mm256_slli_si256(x, 4));
+        x = _mm256_add_epi8(x, _mm256_slli_si256(x, 8));
+        const __m256i lowLast = _mm256_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+        x = _mm256_add_epi8(x, _mm256_permute2x128_si256(lowLast, lowLast, 0x08));
+        x = _mm256_add_epi8(x, last);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), x);
+        last = _mm256_permutevar8x32_epi32(x, lastIndex);
+    }
+    return i;
+}
+
+SIMD_TARGET("avx2")
+static size_t unfilterUpAvx2(unsigned char* out, const unsigned char* in, const unsigned char* previous,
+                             size_t length) {
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        const __m256i up = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(previous + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_add_epi8(x, up));
+    }
+    return i;
+}
+
+SIMD_TARGET("avx2")
+static unsigned unfilterAvx2(unsigned char* out, const unsigned char* in, const unsigned char* previous,
+                             size_t length, unsigned char filterType) {
+    size_t done = 0;
+    switch (filterType) {
+        case 1: done = unfilterSubAvx2(out, in, length); break;
+        case 2: done = unfilterUpAvx2(out, in, previous, length); break;
+        default: return unfilterSse41(out, in, previous, length, filterType);
+    }
+    unfilterTail(out, in, previous, done, length, filterType);
+    return 0;
+}
+#endif
+
+static UnfilterKernel selectUnfilterKernel() {
+#ifdef ENC_DEC_X86_SIMD
+    if (cpuFeatures().avx2) return unfilterAvx2;
+    if (cpuFeatures().sse41) return unfilterSse41;
+#endif
+    return unfilterScalar;
+}
+
+unsigned unfilterRgba8(unsigned char* out, const unsigned char* in, const unsigned char* previous,
+                       size_t length, unsigned char filterType) {
+    static const UnfilterKernel kernel = selectUnfilterKernel();
+    
+    if (previous == nullptr) {
+        // First scanline: the row above is all zero, so Up is a copy and Paeth
+        // is Sub; Average still needs its own pass
+        switch (filterType) {
+            case 2: filterType = 0; break;
+            case 4: filterType = 1; break;
+            case 3:
+                for (size_t i = 0; i < length; i++) {
+                    out[i] = static_cast<unsigned char>(in[i] + (i >= PIXEL_BYTES ? out[i - PIXEL_BYTES] >> 1 : 0));
+                }
+                return 0;
+        }
+        previous = in; // not read by None or Sub
+    }
+    return kernel(out, in, previous, length, filterType);
+}
+
+// Called by lodepng for scanlines with 4-byte pixels (LODEPNG_EXTERNAL_UNFILTER)
+unsigned lodepng_unfilter_scanline4(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                            unsigned char filterType, size_t length) {
+    return unfilterRgba8(recon, scanline, precon, length, filterType);
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+// Reverses one PNG filter for a scanline with 4 bytes per pixel (RGBA8, the
+// only layout this program writes). Sub and Up run 16 or 32 bytes per step;
+// Average and Paeth are serial per pixel but handle all four channels in one
+// SSE register. Kernels are picked at runtime. previous may be null for the
+// first scanline, and out may alias in. Returns a lodepng error code.
+unsigned unfilterRgba8(unsigned char* out, const unsigned char* in, const unsigned char* previous,
+                       size_t length, unsigned char filterType);
@@ -0,0 +1,263 @@
+#include "png_stream.h"
+#include "png_codec.h"
+#include "png_filter.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef ENC_DEC_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+using namespace std;
+
+// Compressed data is read from the file in blocks of this size
+const size_t PNG_STREAM_INPUT_SIZE = 64 * 1024;
+
+static uint32_t readBigEndian32(const unsigned char* bytes) {
+    return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+           (static_cast<uint32_t>(bytes[2]) << 8) | static_cast<uint32_t>(bytes[3]);
+}
+
+SparsePngReader::SparsePngReader()
+    : file(nullptr), inflater(nullptr), streaming(false), imageWidth(0), imageHeight(0),
+      stride(0), rowsDecoded(0), idatRemaining(0), inIdat(false), inputDone(false) {
+}
+
+SparsePngReader::~SparsePngReader() {
+    close();
+}
+
+void SparsePngReader::close() {
+#ifdef ENC_DEC_WITH_ZLIB
+    if (inflater != nullptr) {
+        z_stream* stream = static_cast<z_stream*>(inflater);
+        inflateEnd(stream);
+        delete stream;
+        inflater = nullptr;
+    }
+#endif
+    if (file != nullptr) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+unsigned SparsePngReader::open(const string& filename) {
+    close();
+    streaming = false;
+    retained.clear();
+    rowsDecoded = 0;
+    idatRemaining = 0;
+    inIdat = false;
+    inputDone = false;
+    
+    unsigned error;
+#ifdef ENC_DEC_WITH_ZLIB
+    file = fopen(filename.c_str(), "rb");
+    if (file == nullptr) {
+        return 78;
+    }
+    
+    error = readHeader();
+    if (error == 0 && streaming) {
+        z_stream* stream = new z_stream();
+        if (inflateInit(stream) != Z_OK) {
+            delete stream;
+            return 83;
+        }
+        inflater = stream;
+        return 0;
+    }
+    close();
+    if (error) {
+        return error;
+    }
+#endif
+    
+    // Unsupported layout (or no zlib): decode everything and serve it from memory
+    error = decodePng(retained, imageWidth, imageHeight, filename);
+    if (error) {
+        return error;
+    }
+    stride = static_cast<size_t>(imageWidth) * 4;
+    rowsDecoded = imageHeight;
+    return 0;
+}
+
+// Parses the signature and IHDR; only sets streaming for layouts it can handle
+unsigned SparsePngReader::readHeader() {
+    static const unsigned char SIGNATURE[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    unsigned char header[8 + 8 + 13 + 4];
+    
+    if (fread(header, 1, sizeof(header), file) != sizeof(header)) {
+        return 27;
+    }
+    if (memcmp(header, SIGNATURE, 8) != 0) {
+        return 28;
+    }
+    if (readBigEndian32(header + 8) != 13 || memcmp(header + 12, "IHDR", 4) != 0) {
+        return 29;
+    }
+    
+    const unsigned char* ihdr = header + 16;
+    imageWidth = readBigEndian32(ihdr);
+    imageHeight = readBigEndian32(ihdr + 4);
+    const unsigned bitDepth = ihdr[8];
+    const unsigned colorType = ihdr[9];
+    const unsigned interlace = ihdr[12];
+    
+    if (imageWidth == 0 || imageHeight == 0 || imageWidth > (1u << 24)) {
+        return 92;
+    }
+    
+    streaming = bitDepth == 8 && colorType == 6 && ihdr[10] == 0 && ihdr[11] == 0 && interlace == 0;
+    if (streaming) {
+        stride = static_cast<size_t>(imageWidth) * 4;
+        input.resize(PNG_STREAM_INPUT_SIZE);
+        filteredRow.resize(stride + 1);
+        previousRow.assign(stride, 0);
+        currentRow.assign(stride, 0);
+    }
+    return 0;
+}
+
+// Refills the inflate input from the next IDAT bytes in the file. Chunk CRCs are
+// not checked here; callers authenticate the extracted payload themselves.
+unsigned SparsePngReader::readInput() {
+#ifdef ENC_DEC_WITH_ZLIB
+    while (idatRemaining == 0) {
+        unsigned char chunkHeader[8];
+        if (inIdat && fseek(file, 4, SEEK_CUR) != 0) {
+            return 30;
+        }
+        inIdat = false;
+        
+        if (fread(chunkHeader, 1, 8, file) != 8) {
+            return 30;
+        }
+        const uint32_t length = readBigEndian32(chunkHeader);
+        if (length > 0x7fffffffu) {
+            return 63;
+        }
+        
+        if (memcmp(chunkHeader + 4, "IDAT", 4) == 0) {
+            idatRemaining = length;
+            inIdat = true;
+        } else if (memcmp(chunkHeader + 4, "IEND", 4) == 0) {
+            return 91;
+        } else if (fseek(file, static_cast<long>(length) + 4, SEEK_CUR) != 0) {
+            return 30;
+        }
+    }
+    
+    const size_t toRead = min(static_cast<size_t>(idatRemaining), input.size());
+    if (fread(input.data(), 1, toRead, file) != toRead) {
+        return 30;
+    }
+    idatRemaining -= static_cast<uint32_t>(toRead);
+    
+    z_stream* stream = static_cast<z_stream*>(inflater);
+    stream->next_in = input.data();
+    stream->avail_in = static_cast<uInt>(toRead);
+    return 0;
+#else
+    return 110;
+#endif
+}
+
+// Inflates and unfilters the next scanline into currentRow
+unsigned SparsePngReader::nextRow() {
+#ifdef ENC_DEC_WITH_ZLIB
+    if (rowsDecoded >= imageHeight) {
+        return 91;
+    }
+    
+    z_stream* stream = static_cast<z_stream*>(inflater);
+    stream->next_out = filteredRow.data();
+    stream->avail_out = static_cast<uInt>(filteredRow.size());
+    
+    while (stream->avail_out > 0) {
+        if (inputDone) {
+            return 91;
+        }
+        if (stream->avail_in == 0) {
+            unsigned error = readInput();
+            if (error) {
+                return error;
+            }
+        }
+        
+        const int status = inflate(stream, Z_NO_FLUSH);
+        if (status == Z_STREAM_END) {
+            inputDone = true;
+        } else if (status != Z_OK && status != Z_BUF_ERROR) {
+            return 110;
+        }
+    }
+    
+    previousRow.swap(currentRow);
+    unsigned error = unfilterRgba8(currentRow.data(), filteredRow.data() + 1, previousRow.data(),
+                                   stride, filteredRow[0]);
+    if (error) {
+        return error;
+    }
+    
+    rowsDecoded++;
+    return 0;
+#else
+    return 110;
+#endif
+}
+
+unsigned SparsePngReader::retainRows(unsigned rowCount) {
+    rowCount = min(rowCount, imageHeight);
+    if (!streaming) {
+        return 0; // everything is already retained
+    }
+    
+    while (rowsDecoded < rowCount) {
+        unsigned error = nextRow();
+        if (error) {
+            return error;
+        }
+        retained.insert(retained.end(), currentRow.begin(), currentRow.end());
+    }
+    return 0;
+}
+
+unsigned SparsePngReader::gather(const vector<size_t>& offsets, vector<unsigned char>& values) {
+    values.resize(offsets.size());
+    
+    // Visit offsets in ascending order so each scanline is decoded at most once
+    vector<size_t> order(offsets.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = i;
+    }
+    sort(order.begin(), order.end(), [&offsets](size_t a, size_t b) { return offsets[a] < offsets[b]; });
+    
+    const size_t imageSize = stride * imageHeight;
+    for (size_t i : order) {
+        const size_t offset = offsets[i];
+        if (offset >= imageSize) {
+            return 91;
+        }
+        
+        if (offset < retained.size()) {
+            values[i] = retained[offset];
+            continue;
+        }
+        
+        const size_t row = offset / stride;
+        if (row + 1 < rowsDecoded) {
+            return 91; // already streamed past this row
+        }
+        while (rowsDecoded <= row) {
+            unsigned error = nextRow();
+            if (error) {
+                return error;
+            }
+        }
+        values[i] = currentRow[offset - row * stride];
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+
+// Reads an RGBA8 PNG scanline by scanline instead of decoding it whole.
+// Rows requested through retainRows() are kept in memory; gather() streams
+// forward from there and keeps only the requested bytes, stopping at the row
+// holding the highest offset. Needs zlib (ENC_DEC_WITH_ZLIB) and a
+// non-interlaced RGBA8 image; anything else falls back to a full decode with
+// every row retained, so callers see the same interface either way.
+class SparsePngReader {
+public:
+    SparsePngReader();
+    ~SparsePngReader();
+    
+    // Returns a lodepng error code (0 on success)
+    unsigned open(const std::string& filename);
+    
+    unsigned width() const { return imageWidth; }
+    unsigned height() const { return imageHeight; }
+    bool isStreaming() const { return streaming; }
+    
+    // Decodes and keeps rows [0, rowCount); must be called before gather()
+    unsigned retainRows(unsigned rowCount);
+    size_t retainedSize() const { return retained.size(); }
+    unsigned char retainedByte(size_t offset) const { return retained[offset]; }
+    
+    // Fetches the bytes at the given image offsets (any order), streaming past the
+    // retained rows at most once. Offsets in rows already streamed by an earlier
+    // gather() call are an error.
+    unsigned gather(const std::vector<size_t>& offsets, std::vector<unsigned char>& values);
+    
+private:
+    SparsePngReader(const SparsePngReader&);
+    SparsePngReader& operator=(const SparsePngReader&);
+    
+    unsigned readHeader();
+    unsigned readInput();
+    unsigned nextRow();
+    void close();
+    
+    FILE* file;
+    void* inflater; // z_stream, kept opaque so zlib.h stays out of this header
+    bool streaming;
+    unsigned imageWidth;
+    unsigned imageHeight;
+    size_t stride;
+    unsigned rowsDecoded;
+    uint32_t idatRemaining;
+    bool inIdat;
+    bool inputDone;
+    
+    std::vector<unsigned char> input;
+    std::vector<unsigned char> filteredRow;
+    std::vector<unsigned char> previousRow;
+    std::vector<unsigned char> currentRow;
+    std::vector<unsigned char> retained;
+};
@@ -0,0 +1,417 @@
+#include "reed_solomon.h"
+#include "cpu_features.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef ENC_DEC_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+const unsigned GF_POLYNOMIAL = 0x11d;
+
+// Regions shorter than this skip building the nibble tables
+const size_t GF_REGION_MIN_SIMD = 32;
+
+struct GaloisTables {
+    unsigned char exp[512]; // doubled so exp[log a + log b] needs no modulo
+    unsigned char log[256];
+};
+
+static GaloisTables buildGaloisTables() {
+    GaloisTables tables;
+    unsigned value = 1;
+    for (unsigned i = 0; i < 255; i++) {
+        tables.exp[i] = static_cast<unsigned char>(value);
+        tables.log[value] = static_cast<unsigned char>(i);
+        value <<= 1;
+        if (value & 0x100) {
+            value ^= GF_POLYNOMIAL;
+        }
+    }
+    for (unsigned i = 255; i < 512; i++) {
+        tables.exp[i] = tables.exp[i - 255];
+    }
+    tables.log[0] = 0; // never used; log(0) is undefined
+    return tables;
+}
+
+static const GaloisTables& galois() {
+    static const GaloisTables tables = buildGaloisTables();
+    return tables;
+}
+
+unsigned char gfMul(unsigned char a, unsigned char b) {
+    if (a == 0 || b == 0) return 0;
+    const GaloisTables& gf = galois();
+    return gf.exp[gf.log[a] + gf.log[b]];
+}
+
+static unsigned char gfDiv(unsigned char a, unsigned char b) {
+    if (a == 0) return 0;
+    const GaloisTables& gf = galois();
+    return gf.exp[gf.log[a] + 255 - gf.log[b]];
+}
+
+// a^power for the primitive element a = 2
+static unsigned char gfPow(unsigned power) {
+    return galois().exp[power % 255];
+}
+
+// Evaluates a lowest-degree-first polynomial at x
+static unsigned char evaluate(const vector<unsigned char>& poly, unsigned char x) {
+    unsigned char result = 0;
+    for (size_t i = poly.size(); i-- > 0;) {
+        result = gfMul(result, x) ^ poly[i];
+    }
+    return result;
+}
+
+static void gfMulAddScalar(unsigned char* dst, const unsigned char* src, unsigned char coefficient, size_t length) {
+    const GaloisTables& gf = galois();
+    const unsigned logCoefficient = gf.log[coefficient];
+    for (size_t i = 0; i < length; i++) {
+        if (src[i] != 0) {
+            dst[i] ^= gf.exp[logCoefficient + gf.log[src[i]]];
+        }
+    }
+}
+
+#ifdef ENC_DEC_X86_SIMD
+// Products of the coefficient with every low nibble and every high nibble;
+// a byte's product is the XOR of one entry from each table
+static void nibbleTables(unsigned char coefficient, unsigned char low[16], unsigned char high[16]) {
+    for (unsigned i = 0; i < 16; i++) {
+        low[i] = gfMul(coefficient, static_cast<unsigned char>(i));
+        high[i] = gfMul(coefficient, static_cast<unsigned char>(i << 4));
+    }
+}
+
+SIMD_TARGET("ssse3")
+static void gfMulAddSsse3(unsigned char* dst, const unsigned char* src, unsigned char coefficient, size_t length) {
+    unsigned char low[16], high[16];
+    nibbleTables(coefficient, low, high);
+    const __m128i lowTable = _mm_loadu_si128(reinterpret_cast<const __m128i*>(low));
+    const __m128i highTable = _mm_loadu_si128(reinterpret_cast<const __m128i*>(high));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        const __m128i product = _mm_xor_si128(
+            _mm_shuffle_epi8(lowTable, _mm_and_si128(value, mask)),
+            _mm_shuffle_epi8(highTable, _mm_and_si128(_mm_srli_epi64(value, 4), mask)));
+        __m128i* out = reinterpret_cast<__m128i*>(dst + i);
+        _mm_storeu_si128(out, _mm_xor_si128(_mm_loadu_si128(out), product));
+    }
+    gfMulAddScalar(dst + i, src + i, coefficient, length - i);
+}
+
+SIMD_TARGET("avx2")
+static void gfMulAddAvx2(unsigned char* dst, const unsigned char* src, unsigned char coefficient, size_t length) {
+    unsigned char low[16], high[16];
+    nibbleTables(coefficient, low, high);
+    const __m256i lowTable = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(low)));
+    const __m256i highTable = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(high)));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        const __m256i product = _mm256_xor_si256(
+            _mm256_shuffle_epi8(lowTable, _mm256_and_si256(value, mask)),
+            _mm256_shuffle_epi8(highTable, _mm256_and_si256(_mm256_srli_epi64(value, 4), mask)));
+        __m256i* out = reinterpret_cast<__m256i*>(dst + i);
+        _mm256_storeu_si256(out, _mm256_xor_si256(_mm256_loadu_si256(out), product));
+    }
+    gfMulAddScalar(dst + i, src + i, coefficient, length - i);
+}
+#endif
+
+typedef void (*GfMulAddKernel)(unsigned char*, const unsigned char*, unsigned char, size_t);
+
+static GfMulAddKernel selectGfMulAddKernel() {
+#ifdef ENC_DEC_X86_SIMD
+    if (cpuFeatures().avx2) return gfMulAddAvx2;
+    if (cpuFeatures().ssse3) return gfMulAddSsse3;
+#endif
+    return gfMulAddScalar;
+}
+
+void gfMulAddRegion(unsigned char* dst, const unsigned char* src, unsigned char coefficient, size_t length) {
+    static const GfMulAddKernel kernel = selectGfMulAddKernel();
+    if (coefficient == 0) {
+        return;
+    }
+    if (coefficient == 1) {
+        for (size_t i = 0; i < length; i++) dst[i] ^= src[i];
+        return;
+    }
+    if (length < GF_REGION_MIN_SIMD) {
+        gfMulAddScalar(dst, src, coefficient, length);
+        return;
+    }
+    kernel(dst, src, coefficient, length);
+}
+
+ReedSolomon::ReedSolomon(unsigned paritySymbols)
+    : parity(max(1u, min(paritySymbols, static_cast<unsigned>(RS_MAX_CODEWORD - 1)))) {
+    // g(x) = (x - a^0)(x - a^1)...(x - a^(parity-1))
+    generator.assign(1, 1);
+    for (unsigned i = 0; i < parity; i++) {
+        const unsigned char root = gfPow(i);
+        generator.push_back(0);
+        for (size_t j = generator.size() - 1; j > 0; j--) {
+            generator[j] ^= gfMul(generator[j - 1], root);
+        }
+    }
+}
+
+size_t ReedSolomon::blockCount(size_t dataLength) const {
+    const size_t dataPerBlock = RS_MAX_CODEWORD - parity;
+    return max(static_cast<size_t>(1), (dataLength + dataPerBlock - 1) / dataPerBlock);
+}
+
+// Runs the generator's LFSR over every block at once: row j holds data symbol j
+// of each block, so each step is a handful of region multiply-adds
+void ReedSolomon::encode(const unsigned char* data, size_t dataLength, unsigned char* parityOut) const {
+    const size_t blocks = blockCount(dataLength);
+    const size_t rows = (dataLength + blocks - 1) / blocks;
+    
+    // Parity registers as a ring of rows; register k is row (head + k) % parity
+    vector<unsigned char> registers(parity * blocks, 0);
+    vector<unsigned char> feedback(blocks);
+    vector<unsigned char> padded(blocks);
+    size_t head = 0;
+    
+    for (size_t j = 0; j < rows; j++) {
+        const unsigned char* row = data + j * blocks;
+        if ((j + 1) * blocks > dataLength) {
+            // Blocks past the end of the data see zero symbols
+            fill(padded.begin(), padded.end(), 0);
+            memcpy(padded.data(), row, dataLength - j * blocks);
+            row = padded.data();
+        }
+        
+        unsigned char* first = &registers[head * blocks];
+        for (size_t b = 0; b < blocks; b++) {
+            feedback[b] = row[b] ^ first[b];
+        }
+        memset(first, 0, blocks);
+        head = (head + 1) % parity;
+        
+        for (unsigned k = 0; k < parity; k++) {
+            gfMulAddRegion(&registers[((head + k) % parity) * blocks], feedback.data(), generator[k + 1], blocks);
+        }
+    }
+    
+    for (unsigned k = 0; k < parity; k++) {
+        memcpy(parityOut + k * blocks, &registers[((head + k) % parity) * blocks], blocks);
+    }
+}
+
+bool ReedSolomon::decode(unsigned char* codeword, size_t dataLength,
+                         const vector<size_t>& erasures, size_t* correctedCount) const {
+    const size_t blocks = blockCount(dataLength);
+    const size_t rows = (dataLength + blocks - 1) / blocks;
+    const size_t length = rows + parity;
+    const size_t codewordLength = dataLength + parity * blocks;
+    
+    // Block and symbol index of every codeword byte
+    auto locate = [&](size_t position, size_t& block, size_t& symbol) {
+        if (position < dataLength) {
+            block = position % blocks;
+            symbol = position / blocks;
+        } else {
+            block = (position - dataLength) % blocks;
+            symbol = rows + (position - dataLength) / blocks;
+        }
+    };
+    
+    // Syndromes of all blocks at once: S_i += r_j * a^(i * (length - 1 - j)) for each row j
+    vector<unsigned char> syndromes(parity * blocks, 0);
+    vector<unsigned char> padded(blocks);
+    for (size_t j = 0; j < length; j++) {
+        const unsigned char* row;
+        if (j < rows) {
+            row = codeword + j * blocks;
+            if ((j + 1) * blocks > dataLength) {
+                fill(padded.begin(), padded.end(), 0);
+                memcpy(padded.data(), row, dataLength - j * blocks);
+                row = padded.data();
+            }
+        } else {
+            row = codeword + dataLength + (j - rows) * blocks;
+        }
+        
+        const unsigned power = static_cast<unsigned>(length - 1 - j);
+        for (unsigned i = 0; i < parity; i++) {
+            gfMulAddRegion(&syndromes[i * blocks], row, gfPow(i * power), blocks);
+        }
+    }
+    
+    vector<vector<unsigned>> erasurePowers(blocks);
+    for (size_t position : erasures) {
+        if (position >= codewordLength) {
+            return false;
+        }
+        size_t block, symbol;
+        locate(position, block, symbol);
+        erasurePowers[block].push_back(static_cast<unsigned>(length - 1 - symbol));
+    }
+    
+    size_t corrected = 0;
+    vector<unsigned char> blockSyndromes(parity);
+    vector<unsigned char> symbols(length);
+    for (size_t b = 0; b < blocks; b++) {
+        bool clean = erasurePowers[b].empty();
+        for (unsigned i = 0; i < parity; i++) {
+            blockSyndromes[i] = syndromes[i * blocks + b];
+            clean = clean && blockSyndromes[i] == 0;
+        }
+        if (clean) {
+            continue;
+        }
+        
+        // Gather the block, with zeros where it runs past the data
+        for (size_t j = 0; j < length; j++) {
+            const size_t position = j < rows ? j * blocks + b : dataLength + (j - rows) * blocks + b;
+            symbols[j] = (j >= rows || position < dataLength) ? codeword[position] : 0;
+        }
+        
+        if (!decodeBlock(symbols.data(), length, erasurePowers[b], blockSyndromes.data(), corrected)) {
+            return false;
+        }
+        
+        for (size_t j = 0; j < length; j++) {
+            const size_t position = j < rows ? j * blocks + b : dataLength + (j - rows) * blocks + b;
+            if (j < rows && position >= dataLength) {
+                if (symbols[j] != 0) return false; // "corrected" a padding symbol
+                continue;
+            }
+            codeword[position] = symbols[j];
+        }
+    }
+    
+    if (correctedCount != nullptr) {
+        *correctedCount = corrected;
+    }
+    return true;
+}
+
+// Errors-and-erasures decoding of one codeword (highest degree first):
+// Berlekamp-Massey seeded with the erasure locator, Chien search, then Forney
+bool ReedSolomon::decodeBlock(unsigned char* block, size_t length, const vector<unsigned>& erasurePowers,
+                              const unsigned char* syndromes, size_t& corrected) const {
+    const size_t erasureCount = erasurePowers.size();
+    if (erasureCount > parity) {
+        return false;
+    }
+    
+    // Polynomials below are lowest degree first
+    vector<unsigned char> locator(1, 1);
+    for (unsigned power : erasurePowers) {
+        const unsigned char root = gfPow(power);
+        locator.push_back(0);
+        for (size_t i = locator.size() - 1; i > 0; i--) {
+            locator[i] ^= gfMul(locator[i - 1], root);
+        }
+    }
+    
+    vector<unsigned char> previous = locator;
+    size_t degree = erasureCount;
+    size_t shift = 1;
+    unsigned char lastDiscrepancy = 1;
+    
+    for (size_t k = erasureCount; k < parity; k++) {
+        unsigned char discrepancy = 0;
+        for (size_t i = 0; i < locator.size() && i <= k; i++) {
+            discrepancy ^= gfMul(locator[i], syndromes[k - i]);
+        }
+        
+        if (discrepancy == 0) {
+            shift++;
+            continue;
+        }
+        
+        const unsigned char scale = gfDiv(discrepancy, lastDiscrepancy);
+        vector<unsigned char> updated = locator;
+        if (updated.size() < previous.size() + shift) {
+            updated.resize(previous.size() + shift, 0);
+        }
+        for (size_t i = 0; i < previous.size(); i++) {
+            updated[i + shift] ^= gfMul(scale, previous[i]);
+        }
+        
+        if (2 * degree <= k + erasureCount) {
+            degree = k + 1 + erasureCount - degree;
+            previous = locator;
+            lastDiscrepancy = discrepancy;
+            shift = 1;
+        } else {
+            shift++;
+        }
+        locator.swap(updated);
+    }
+    
+    while (locator.size() > 1 && locator.back() == 0) {
+        locator.pop_back();
+    }
+    if (locator.size() - 1 != degree || degree > parity) {
+        return false;
+    }
+    
+    // Chien search: an error at power p makes locator(a^-p) vanish
+    vector<unsigned> errorPowers;
+    for (unsigned p = 0; p < length; p++) {
+        if (evaluate(locator, gfPow(255 - p)) == 0) {
+            errorPowers.push_back(p);
+        }
+    }
+    if (errorPowers.size() != degree) {
+        return false;
+    }
+    
+    // Evaluator omega = S(x) * locator(x) mod x^parity
+    vector<unsigned char> evaluator(parity, 0);
+    for (size_t i = 0; i < parity; i++) {
+        for (size_t j = 0; j < locator.size() && j <= i; j++) {
+            evaluator[i] ^= gfMul(syndromes[i - j], locator[j]);
+        }
+    }
+    
+    // Formal derivative keeps the odd terms only (characteristic 2)
+    vector<unsigned char> derivative;
+    for (size_t i = 1; i < locator.size(); i++) {
+        derivative.push_back((i & 1) ? locator[i] : 0);
+    }
+    
+    for (unsigned p : errorPowers) {
+        const unsigned char x = gfPow(p);
+        const unsigned char xInverse = gfPow(255 - p);
+        const unsigned char denominator = evaluate(derivative, xInverse);
+        if (denominator == 0) {
+            return false;
+        }
+        // With roots starting at a^0 the magnitude is X * omega(1/X) / locator'(1/X)
+        const unsigned char magnitude = gfMul(x, gfDiv(evaluate(evaluator, xInverse), denominator));
+        if (magnitude != 0) {
+            block[length - 1 - p] ^= magnitude;
+            corrected++;
+        }
+    }
+    
+    // A miscorrection beyond the code's capacity leaves nonzero syndromes behind
+    for (unsigned i = 0; i < parity; i++) {
+        unsigned char syndrome = 0;
+        const unsigned char root = gfPow(i);
+        for (size_t j = 0; j < length; j++) {
+            syndrome = gfMul(syndrome, root) ^ block[j];
+        }
+        if (syndrome != 0) {
+            return false;
+        }
+    }
+    return true;
+}
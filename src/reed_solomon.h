@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// Largest codeword over GF(256)
+const size_t RS_MAX_CODEWORD = 255;
+
+// GF(256) arithmetic with the 0x11d field polynomial (table driven)
+unsigned char gfMul(unsigned char a, unsigned char b);
+// dst[i] ^= coefficient * src[i]; SSSE3/AVX2 nibble-table kernels when available
+void gfMulAddRegion(unsigned char* dst, const unsigned char* src, unsigned char coefficient, size_t length);
+
+// Systematic Reed-Solomon code (generator roots a^0 .. a^(parity-1)).
+// Messages longer than one codeword are interleaved over several blocks:
+// data byte i belongs to block i % blockCount, so a run of damaged bytes is
+// spread across codewords. The parity that follows the data is stored row by
+// row: parity symbol k of every block, then symbol k + 1, and so on.
+class ReedSolomon {
+public:
+    // Each block corrects up to paritySymbols / 2 errors, or paritySymbols erasures
+    explicit ReedSolomon(unsigned paritySymbols);
+
+    unsigned paritySymbols() const { return parity; }
+    size_t blockCount(size_t dataLength) const;
+    size_t parityLength(size_t dataLength) const { return blockCount(dataLength) * parity; }
+
+    // Writes parityLength(dataLength) bytes of parity for data
+    void encode(const unsigned char* data, size_t dataLength, unsigned char* parityOut) const;
+
+    // Corrects codeword (data followed by its parity) in place. Erasures are known-bad
+    // byte positions in the codeword. Returns false if any block is uncorrectable.
+    bool decode(unsigned char* codeword, size_t dataLength,
+                const std::vector<size_t>& erasures = std::vector<size_t>(),
+                size_t* correctedCount = nullptr) const;
+
+private:
+    bool decodeBlock(unsigned char* block, size_t length, const std::vector<unsigned>& erasurePowers,
+                     const unsigned char* syndromes, size_t& corrected) const;
+
+    unsigned parity;
+    std::vector<unsigned char> generator; // monic, highest degree first
+};
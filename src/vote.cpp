@@ -0,0 +1,118 @@
+#include "vote.h"
+#include "cpu_features.h"
+#include <cstring>
+
+#ifdef ENC_DEC_X86_SIMD
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// Counted voting compares every copy against every other one, which for the
+// small copy counts used here is cheaper than any table or tree
+static void voteCountedScalar(const unsigned char* copies, size_t copyCount, size_t length,
+                              unsigned char* out, size_t begin) {
+    for (size_t i = begin; i < length; i++) {
+        unsigned char best = 0;
+        size_t bestCount = 0;
+        
+        for (size_t j = 0; j < copyCount; j++) {
+            const unsigned char value = copies[j * length + i];
+            size_t count = 0;
+            for (size_t k = 0; k < copyCount; k++) {
+                count += copies[k * length + i] == value;
+            }
+            if (count > bestCount || (count == bestCount && value < best)) {
+                best = value;
+                bestCount = count;
+            }
+        }
+        
+        out[i] = best;
+    }
+}
+
+#ifdef ENC_DEC_X86_SIMD
+SIMD_TARGET("sse2")
+static void voteCountedSse2(const unsigned char* copies, size_t copyCount, size_t length,
+                            unsigned char* out, size_t begin) {
+    size_t i = begin;
+    for (; i + 16 <= length; i += 16) {
+        __m128i best = _mm_setzero_si128();
+        __m128i bestCount = _mm_setzero_si128();
+        
+        for (size_t j = 0; j < copyCount; j++) {
+            const __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(copies + j * length + i));
+            __m128i count = _mm_setzero_si128();
+            for (size_t k = 0; k < copyCount; k++) {
+                const __m128i other = _mm_loadu_si128(reinterpret_cast<const __m128i*>(copies + k * length + i));
+                count = _mm_sub_epi8(count, _mm_cmpeq_epi8(value, other));
+            }
+            
+            // Unsigned value < best: min(value, best) == value and value != best
+            const __m128i smaller = _mm_andnot_si128(_mm_cmpeq_epi8(value, best),
+                                                     _mm_cmpeq_epi8(_mm_min_epu8(value, best), value));
+            const __m128i take = _mm_or_si128(_mm_cmpgt_epi8(count, bestCount),
+                                              _mm_and_si128(_mm_cmpeq_epi8(count, bestCount), smaller));
+            best = _mm_or_si128(_mm_and_si128(take, value), _mm_andnot_si128(take, best));
+            bestCount = _mm_or_si128(_mm_and_si128(take, count), _mm_andnot_si128(take, bestCount));
+        }
+        
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), best);
+    }
+    voteCountedScalar(copies, copyCount, length, out, i);
+}
+
+SIMD_TARGET("avx2")
+static void voteCountedAvx2(const unsigned char* copies, size_t copyCount, size_t length,
+                            unsigned char* out, size_t begin) {
+    size_t i = begin;
+    for (; i + 32 <= length; i += 32) {
+        __m256i best = _mm256_setzero_si256();
+        __m256i bestCount = _mm256_setzero_si256();
+        
+        for (size_t j = 0; j < copyCount; j++) {
+            const __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(copies + j * length + i));
+            __m256i count = _mm256_setzero_si256();
+            for (size_t k = 0; k < copyCount; k++) {
+                const __m256i other = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(copies + k * length + i));
+                count = _mm256_sub_epi8(count, _mm256_cmpeq_epi8(value, other));
+            }
+            
+            const __m256i smaller = _mm256_andnot_si256(_mm256_cmpeq_epi8(value, best),
+                                                        _mm256_cmpeq_epi8(_mm256_min_epu8(value, best), value));
+            const __m256i take = _mm256_or_si256(_mm256_cmpgt_epi8(count, bestCount),
+                                                 _mm256_and_si256(_mm256_cmpeq_epi8(count, bestCount), smaller));
+            best = _mm256_blendv_epi8(best, value, take);
+            bestCount = _mm256_blendv_epi8(bestCount, count, take);
+        }
+        
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), best);
+    }
+    voteCountedSse2(copies, copyCount, length, out, i);
+}
+#endif
+
+typedef void (*VoteKernel)(const unsigned char*, size_t, size_t, unsigned char*, size_t);
+
+static VoteKernel selectCountedKernel() {
+#ifdef ENC_DEC_X86_SIMD
+    if (cpuFeatures().avx2) return voteCountedAvx2;
+    if (cpuFeatures().sse2) return voteCountedSse2;
+#endif
+    return voteCountedScalar;
+}
+
+bool voteBytes(const unsigned char* copies, size_t copyCount, size_t length, unsigned char* out) {
+    if (copyCount == 0 || copyCount > VOTE_MAX_COPIES) {
+        return false;
+    }
+    
+    if (copyCount == 1) {
+        memmove(out, copies, length);
+    } else {
+        static const VoteKernel kernel = selectCountedKernel();
+        kernel(copies, copyCount, length, out, 0);
+    }
+    return true;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+
+// Redundant copies of a byte string are voted on from one flat, copy-major
+// buffer: copy c of byte i lives at copies[c * length + i]. Nothing is
+// allocated, and the kernels work on many byte positions at once.
+const size_t VOTE_MAX_COPIES = 15;
+
+// Writes length voted bytes to out: the most frequent value per byte, ties going
+// to the smallest value. Returns false if copyCount is 0 or above VOTE_MAX_COPIES.
+bool voteBytes(const unsigned char* copies, size_t copyCount, size_t length, unsigned char* out);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <cstddef>
+
+// Runs task(0) .. task(count - 1) on up to `threads` threads (0 = one per core),
+// the calling thread included. Workers pull the next task index, so slow tasks
+// don't stall a fixed partition.
+inline void runWorkers(size_t count, unsigned threads, const std::function<void(size_t)>& task) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, count)));
+    
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            task(i);
+        }
+    };
+    
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned t = 1; t < threads; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    
+    for (auto& t : pool) {
+        t.join();
+    }
+}